@@ -70,6 +70,14 @@ void TwoBodyBarycenter::velocityOffset(context& context, glm::dvec3 offset) {
 	context[secondary]->velocity -= offset;
 }
 
+void TwoBodyBarycenter::remap(const std::vector<size_t>& index) {
+	if (primary >= index.size() || secondary >= index.size())
+		return;
+	primary = index[primary];
+	secondary = index[secondary];
+	primaryOrbit->parentIndex = primary;
+}
+
 ComplexBarycenter::ComplexBarycenter(size_t primary, size_t secondary) {
 	this->primary = primary;
 	this->secondaries.push_back(secondary);
@@ -178,4 +186,20 @@ void ComplexBarycenter::velocityOffset(context& context, glm::dvec3 offset) {
 	context[primary]->velocity -= offset;
 	for (size_t secondary : secondaries)
 		context[secondary]->velocity -= offset;
+}
+
+// secondaries that merged into the primary or into each other are listed once
+void ComplexBarycenter::remap(const std::vector<size_t>& index) {
+	if (primary >= index.size())
+		return;
+	primary = index[primary];
+	primaryOrbit->parentIndex = primary;
+
+	std::vector<size_t> remaining;
+	for (size_t secondary : secondaries) {
+		size_t moved = index[secondary];
+		if (moved != primary && std::find(remaining.begin(), remaining.end(), moved) == remaining.end())
+			remaining.push_back(moved);
+	}
+	secondaries = remaining;
 }
\ No newline at end of file
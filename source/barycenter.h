@@ -18,6 +18,7 @@ public:
 	double apparentMass(context& context, size_t observer);
 	void positionOffset(context& context, glm::dvec3 offset);
 	void velocityOffset(context& context, glm::dvec3 offset);
+	void remap(const std::vector<size_t>& index);
 };
 
 class ComplexBarycenter : public Barycenter {
@@ -39,4 +40,5 @@ public:
 	double apparentMass(context& context, size_t observer);
 	void positionOffset(context& context, glm::dvec3 offset);
 	void velocityOffset(context& context, glm::dvec3 offset);
+	void remap(const std::vector<size_t>& index);
 };
\ No newline at end of file
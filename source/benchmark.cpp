@@ -0,0 +1,647 @@
+#include <fstream>
+#include <random>
+#include "benchmark.h"
+#include "barycenter.h"
+#include "builder.h"
+#include "model.h"
+#include "physics.h"
+#include "rotation.h"
+
+struct PrecisionRun {
+	const char* name;
+	bool compensated;		// bodies stepped with compensated sums
+	bool singlePrecision;	// particles stepped in float
+};
+
+// the scene and its test particles stepped once per precision with the selected integrator and engine:
+// plain double throughout, float particles, and compensated bodies with double particles
+// the energy error of the bodies only shows rounding where the integrator's own error is smaller, short steps of
+// the high orders; particles are compared with those of the plain double run at the end
+void precisionBenchmark(size_t steps, double duration) {
+	if (steps == 0)
+		steps = (size_t)ceil(duration / simulationStep);
+
+	applyThreadSettings();
+	BodyStore scene;
+	scene.load(bodies);
+
+	// every particle of the scene in double, or a belt when there are none
+	if (simulation.particles.size() + simulation.floatParticles.size() == 0)
+		GravityBodyBuilder().buildBelt(0, BENCHMARK_BELT, 3.0 * bodies[0]->radius, 6.0 * bodies[0]->radius, 0.02);
+	TestParticles belt = simulation.particles;
+	for (size_t i = 0; i < simulation.floatParticles.size(); i++)
+		belt.add(simulation.floatParticles.position(i), simulation.floatParticles.velocity(i));
+
+	printf("gravity kernel: %s\n", simdLevelName(simdLevel));
+	printf("%zu bodies, %zu test particles, %zu steps of %.3g s\n", scene.size(), belt.size(), steps, simulationStep);
+	printf("%-16s %12s %18s %14s %18s\n", "precision", "steps/s", "particle steps/s", "energy error", "particle rms (Mm)");
+
+	const PrecisionRun runs[] = {
+		{ "double", false, false },
+		{ "float particles", false, true },
+		{ "compensated", true, false }
+	};
+	std::vector<glm::dvec3> reference;
+	for (const PrecisionRun& config : runs) {
+		Simulation run;
+		run.state = scene;
+		run.integrator = integrator;
+		run.regularize = doRegularization;
+		run.compensated = config.compensated;
+		if (config.singlePrecision) {
+			for (size_t i = 0; i < belt.size(); i++)
+				run.floatParticles.add(belt.position(i), belt.velocity(i));
+		}
+		else
+			run.particles = belt;
+		run.reset();
+
+		double initial = measureConserved(run.state).energy();
+		Clock::time_point start = Clock::now();
+		for (size_t step = 0; step < steps; step++)
+			run.step(simulationStep);
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		double error = fabs((measureConserved(run.state).energy() - initial) / initial);
+
+		// distance of every particle from where the plain double run left it
+		double squares = 0.0;
+		for (size_t i = 0; i < belt.size(); i++) {
+			glm::dvec3 position = config.singlePrecision ? run.floatParticles.position(i) : run.particles.position(i);
+			if (reference.size() < belt.size())
+				reference.push_back(position);
+			else
+				squares += glm::dot(position - reference[i], position - reference[i]);
+		}
+		double deviation = belt.size() > 0 ? sqrt(squares / belt.size()) : 0.0;
+
+		printf("%-16s %12.4g %18.4g %14.3e %18.3e\n", config.name,
+			steps / seconds, steps * belt.size() / seconds, error, deviation);
+	}
+}
+
+// mass and scale radius of the cluster every scaling case is drawn from
+static const double CLUSTER_MASS = 2e35, CLUSTER_RADIUS = 3e10;
+
+// results of the cases that would otherwise be optimized away
+static double sink = 0.0;
+
+// repeats body in growing batches until one lasts MICROBENCH_MIN_TIME, after an untimed call
+// that warms the caches and builds whatever the case allocates on first use
+template <class Body>
+static MicroResult measure(const std::string& name, size_t n, Body&& body) {
+	body();
+	size_t iterations = 1;
+	double seconds;
+	while (true) {
+		Clock::time_point start = Clock::now();
+		for (size_t k = 0; k < iterations; k++)
+			body();
+		seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		if (seconds >= MICROBENCH_MIN_TIME)
+			break;
+
+		// aim a little past the target from the rate seen so far, at most a hundredfold at once
+		double scale = seconds > 0.0 ? std::min(100.0, 1.2 * MICROBENCH_MIN_TIME / seconds) : 100.0;
+		iterations = std::max(2 * iterations, (size_t)(iterations * scale));
+	}
+
+	MicroResult result{ name, n, iterations, seconds * 1e9 / iterations };
+	printf("%-20s %8zu %10zu %16.1f\n", name.c_str(), n, iterations, result.nanoseconds);
+	return result;
+}
+
+// n equal bodies in a Plummer sphere, each moving at the circular speed of its radius in a random direction
+static context plummerSphere(size_t n) {
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<double> uniform(0.0, 1.0);
+	auto isotropic = [&](double length) {
+		double z = 2.0 * uniform(rng) - 1.0;
+		double phi = 2.0 * pi * uniform(rng);
+		double planar = sqrt(1.0 - z * z);
+		return length * glm::dvec3(planar * cos(phi), planar * sin(phi), z);
+	};
+
+	context cluster;
+	for (size_t i = 0; i < n; i++) {
+		double radius;
+		do {
+			radius = CLUSTER_RADIUS / sqrt(pow(uniform(rng), -2.0 / 3.0) - 1.0);
+		} while (radius > 20.0 * CLUSTER_RADIUS);
+		double softened = radius * radius + CLUSTER_RADIUS * CLUSTER_RADIUS;
+
+		std::shared_ptr<GravityBody> body = std::make_shared<GravityBody>(CLUSTER_MASS / n);
+		body->radius = CLUSTER_RADIUS * 1e-3;
+		body->position = body->prevPosition = isotropic(radius);
+		body->velocity = isotropic(sqrt(G * CLUSTER_MASS * radius * radius / (softened * sqrt(softened))));
+		cluster.push_back(body);
+	}
+	return cluster;
+}
+
+// what each kernel leaves for every body of a store, summed over all the others
+struct KernelOutput {
+	std::vector<double> ax, ay, az, jx, jy, jz, fx, fy, fz;
+};
+using KernelField = std::vector<double> KernelOutput::*;
+
+static KernelOutput runKernels(const BodyStore& s, simd_level level) {
+	size_t n = s.size();
+	KernelOutput out;
+	for (KernelField field : { &KernelOutput::ax, &KernelOutput::ay, &KernelOutput::az, &KernelOutput::jx,
+		&KernelOutput::jy, &KernelOutput::jz, &KernelOutput::fx, &KernelOutput::fy, &KernelOutput::fz })
+		(out.*field).assign(n, 0.0);
+
+	selectPointGravityKernel(level)(s, out.ax.data(), out.ay.data(), out.az.data(), 0, n, 0, n);
+	// the jerk kernel sums the accelerations again beside the jerks, which are all that is compared of it
+	std::vector<double> ax(n, 0.0), ay(n, 0.0), az(n, 0.0);
+	selectPointJerkKernel(level)(s, ForceOutput{ ax.data(), ay.data(), az.data(), out.jx.data(), out.jy.data(), out.jz.data() },
+		0, n, 0, n);
+	selectTargetFieldKernel(level)(s, s.px.data(), s.py.data(), s.pz.data(), out.fx.data(), out.fy.data(), out.fz.data(), 0, n);
+	return out;
+}
+
+// largest distance of any body's vector from the scalar one, relative to the length of the scalar one
+static double largestDifference(const KernelOutput& result, const KernelOutput& scalar, KernelField x, KernelField y, KernelField z) {
+	double worst = 0.0;
+	for (size_t i = 0; i < (scalar.*x).size(); i++) {
+		glm::dvec3 expected((scalar.*x)[i], (scalar.*y)[i], (scalar.*z)[i]);
+		glm::dvec3 actual((result.*x)[i], (result.*y)[i], (result.*z)[i]);
+		double length = glm::length(expected);
+		if (length > 0.0)
+			worst = std::max(worst, glm::length(actual - expected) / length);
+	}
+	return worst;
+}
+
+// every vector kernel up to the dispatched one against the scalar kernels on a cluster, with the summed accelerations,
+// jerks and fields held to KERNEL_TOLERANCE; returns whether all of them are within it
+static bool checkKernels() {
+	BodyStore store;
+	store.load(plummerSphere(MICROBENCH_CHECK_SIZE));
+	KernelOutput scalar = runKernels(store, SIMD_SCALAR);
+
+	bool within = true;
+	printf("kernels against scalar on %zu bodies, largest relative difference (tolerance %.0e):\n",
+		MICROBENCH_CHECK_SIZE, KERNEL_TOLERANCE);
+	for (int level = SIMD_SSE2; level <= simdLevel; level++) {
+		KernelOutput result = runKernels(store, (simd_level)level);
+		double acceleration = largestDifference(result, scalar, &KernelOutput::ax, &KernelOutput::ay, &KernelOutput::az);
+		double jerk = largestDifference(result, scalar, &KernelOutput::jx, &KernelOutput::jy, &KernelOutput::jz);
+		double field = largestDifference(result, scalar, &KernelOutput::fx, &KernelOutput::fy, &KernelOutput::fz);
+		bool passed = acceleration <= KERNEL_TOLERANCE && jerk <= KERNEL_TOLERANCE && field <= KERNEL_TOLERANCE;
+		printf("  %-8s acceleration %.2e, jerk %.2e, field %.2e%s\n", simdLevelName((simd_level)level),
+			acceleration, jerk, field, passed ? "" : ", past the tolerance");
+		within = within && passed;
+	}
+	if (simdLevel == SIMD_SCALAR)
+		printf("  no vector kernels on this machine\n");
+	return within;
+}
+
+// the physics, geometry and trail paths that run every step or frame, timed on synthetic scenes so the numbers
+// only move when the code does; the models keep no GL buffers while headless, so no context is needed
+// the force passes are timed under every engine, the steps under the selected integrator and engine
+std::vector<MicroResult> microBenchmarks() {
+	applyThreadSettings();
+	std::vector<MicroResult> results;
+	printf("gravity kernel: %s, %zu threads\n", simdLevelName(simdLevel), threadCount(physicsThreads));
+	if (!checkKernels())
+		fprintf(stderr, "vector kernels differ from the scalar ones past %.0e\n", KERNEL_TOLERANCE);
+	printf("%-20s %8s %10s %16s\n", "case", "n", "iterations", "ns/iteration");
+
+	force_engine selected = forceEngine;
+	double dt = 1e-3 * sqrt(CLUSTER_RADIUS * CLUSTER_RADIUS * CLUSTER_RADIUS / (G * CLUSTER_MASS));
+	for (size_t n : MICROBENCH_SIZES) {
+		context cluster = plummerSphere(n);
+		BodyStore store;
+		store.load(cluster);
+		for (uint8_t engine = 0; engine < ENGINE_COUNT; engine++) {
+			forceEngine = (force_engine)engine;
+			results.push_back(measure(std::string("forces ") + engineNames[engine], n, [&] {
+				store.clearForces();
+				computeForces(store);
+			}));
+		}
+		forceEngine = selected;
+
+		Simulation run;
+		run.integrator = integrator;
+		run.regularize = doRegularization;
+		run.compensated = doCompensatedSums;
+		run.load(cluster);
+		results.push_back(measure("step", n, [&] { run.step(dt); }));
+	}
+
+	glm::dquat orientation(1.0, 0.0, 0.0, 0.0);
+	glm::dvec3 momentum(0.3, 1.0, 0.1), torque(1e-3, 0.0, 2e-3), inertia(2.0, 3.0, 2.0);
+	results.push_back(measure("rotateRK4", 1, [&] {
+		orientation = GravityBody::rotateRK4(orientation, momentum, torque, inertia, 1e-3);
+	}));
+	results.push_back(measure("freeRotation", 1, [&] {
+		orientation = freeRotation(orientation, momentum, inertia, 1e-3);
+	}));
+	sink += orientation.w;
+
+	// the orbit constructor and the trails find their bodies in the global lists, so those are set aside
+	// for a star at the origin and put back at the end
+	context scene = std::move(bodies), frameScene = std::move(frameBodies);
+	std::shared_ptr<GravityBody> star = std::make_shared<GravityBody>(2e30);
+	star->radius = 700.0;
+	bodies = { star };
+
+	// every planet pushes the star back by its share of the momentum, undone before the next one
+	float anomaly = 0.0f;
+	results.push_back(measure("orbit constructor", 1, [&] {
+		star->position = star->velocity = glm::dvec3(0.0);
+		anomaly = fmodf(anomaly + 0.1f, 2.0f * pi_f);
+		GravityBody planet(6e24, Orbit(150000.0, 0.2f, 1.0f, 0.5f, 0.1f, anomaly), 0, false);
+		sink += planet.position.x;
+	}));
+	star->position = star->velocity = glm::dvec3(0.0);
+
+	for (int subdivisions = 0; subdivisions <= MICROBENCH_MAX_SUBDIVISIONS; subdivisions++) {
+		results.push_back(measure("icosphere", subdivisions, [&] {
+			Model::Icosphere(subdivisions);
+			Model::modelLibrary.pop_back();
+		}));
+	}
+
+	Trail ellipse;
+	glm::dvec3 position(150000.0, 0.0, 0.0), velocity(0.0, 0.0, 0.033);
+	drawEllipse(&ellipse, position, velocity, star->mass);
+	results.push_back(measure("drawEllipse", ellipse.size(), [&] {
+		drawEllipse(&ellipse, position, velocity, star->mass);
+	}));
+
+	// a planet carried around the star by a thousandth of a turn per call, its trail already one orbit long,
+	// so every call adds a point and drops the one a turn behind
+	std::shared_ptr<GravityBody> planet = std::make_shared<GravityBody>(6e24);
+	Trail path(glm::vec3(1.0f), 0);
+	planet->parentIndex = 0;
+	planet->radius = 6.0;
+	planet->trail = &path;
+	bodies.push_back(planet);
+	frameBodies = bodies;
+	double angle = 0.0, speed = sqrt(G * star->mass / glm::length(position));
+	auto advance = [&] {
+		angle += 2.0 * pi / 1000.0;
+		planet->position = glm::length(position) * glm::dvec3(cos(angle), 0.0, sin(angle));
+		planet->velocity = speed * glm::dvec3(-sin(angle), 0.0, cos(angle));
+		tracePath(0, 1);
+	};
+	for (int k = 0; k < 1000; k++)
+		advance();
+	results.push_back(measure("tracePath", path.size(), advance));
+
+	// a planet with 1 to 100 moons, seen from a body outside the system
+	for (size_t moons : { 1, 10, 100 }) {
+		bodies = { std::make_shared<GravityBody>(6e24) };
+		for (size_t k = 0; k < moons; k++) {
+			double phase = 2.0 * pi * k / moons;
+			bodies.push_back(std::make_shared<GravityBody>(7e22));
+			bodies.back()->position = (400.0 + k) * glm::dvec3(cos(phase), 0.0, sin(phase));
+		}
+		bodies.push_back(std::make_shared<GravityBody>(2e30));
+		bodies.back()->position = glm::dvec3(-150000.0, 0.0, 0.0);
+		size_t observer = bodies.size() - 1;
+
+		ComplexBarycenter system(0, 1);
+		for (size_t k = 2; k <= moons; k++)
+			system.add(k);
+		results.push_back(measure("apparentMass", moons, [&] { sink += system.apparentMass(bodies, observer); }));
+		delete system.primaryOrbit;
+		bodies[0]->barycenter = nullptr;
+	}
+
+	bodies = std::move(scene);
+	frameBodies = std::move(frameScene);
+	return results;
+}
+
+bool writeMicroCSV(const std::filesystem::path& path, const std::vector<MicroResult>& results) {
+	std::ofstream out(path);
+	if (!out)
+		return false;
+
+	out << "case,n,iterations,nanoseconds\n";
+	for (const MicroResult& result : results)
+		out << result.name << ',' << result.n << ',' << result.iterations << ',' << result.nanoseconds << '\n';
+	return true;
+}
+
+// {"kernel": "...", "threads": n, "cases": [{"case": "...", "n": n, "iterations": n, "nanoseconds": ns}, ...]}
+bool writeMicroJSON(const std::filesystem::path& path, const std::vector<MicroResult>& results) {
+	std::ofstream out(path);
+	if (!out)
+		return false;
+
+	out << "{\n\"kernel\": \"" << simdLevelName(simdLevel) << "\", \"threads\": " << threadCount(physicsThreads) << ",\n\"cases\": [\n";
+	for (size_t k = 0; k < results.size(); k++) {
+		const MicroResult& result = results[k];
+		out << "{\"case\": \"" << result.name << "\", \"n\": " << result.n << ", \"iterations\": " << result.iterations
+			<< ", \"nanoseconds\": " << result.nanoseconds << '}' << (k + 1 < results.size() ? ",\n" : "\n");
+	}
+	out << "]\n}\n";
+	return true;
+}
+
+// a standard problem: the units its steps and distances are reported in, how long it runs and the steps
+// it is tried at, both in its time unit, and its bodies
+struct AccuracyScene {
+	const char* timeUnitName;
+	double timeUnit, lengthUnit;
+	double horizon;
+	std::vector<double> steps;
+	BodyStore initial;
+	bool analytic = false;	// a two-body orbit, measured against its Kepler solution rather than a reference run
+
+	// the bodies are filled in by each scene
+	AccuracyScene(const char* timeUnitName, double timeUnit, double lengthUnit, double horizon, std::vector<double> steps) :
+		timeUnitName(timeUnitName), timeUnit(timeUnit), lengthUnit(lengthUnit), horizon(horizon), steps(std::move(steps)) {
+	}
+};
+
+static BodyStore storeOf(const context& list) {
+	BodyStore store;
+	store.load(list);
+	return store;
+}
+
+static std::shared_ptr<GravityBody> pointMass(double mass, const glm::dvec3& position, const glm::dvec3& velocity) {
+	std::shared_ptr<GravityBody> body = std::make_shared<GravityBody>(mass);
+	body->position = body->prevPosition = position;
+	body->velocity = velocity;
+	return body;
+}
+
+// a planet leaving periapsis on an orbit of eccentricity 0.5 around a star, for 100 periods
+static AccuracyScene keplerScene() {
+	const double starMass = 2e30, planetMass = 6e24, semiMajorAxis = 150000.0, eccentricity = 0.5;
+	double total = starMass + planetMass;
+	double gm = G * total;
+	double periapsis = semiMajorAxis * (1.0 - eccentricity);
+	double speed = sqrt(gm * (1.0 + eccentricity) / periapsis);
+
+	AccuracyScene scene{ "periods", 2.0 * pi * sqrt(semiMajorAxis * semiMajorAxis * semiMajorAxis / gm),
+		semiMajorAxis, 100.0, { 1.0 / 64, 1.0 / 256, 1.0 / 1024 } };
+	scene.initial = storeOf({
+		pointMass(starMass, glm::dvec3(-planetMass / total * periapsis, 0.0, 0.0), glm::dvec3(0.0, 0.0, -planetMass / total * speed)),
+		pointMass(planetMass, glm::dvec3(starMass / total * periapsis, 0.0, 0.0), glm::dvec3(0.0, 0.0, starMass / total * speed))
+	});
+	scene.analytic = true;
+	return scene;
+}
+
+// Burrau's problem: masses of 3, 4 and 5 at rest on the corners of a 3-4-5 triangle, in units where G = M = L = 1;
+// a series of close encounters ends near t = 60 with the lightest body thrown out and the other two bound
+static AccuracyScene pythagoreanScene() {
+	const double massUnit = 1e30, lengthUnit = 150000.0;
+	AccuracyScene scene{ "T", sqrt(lengthUnit * lengthUnit * lengthUnit / (G * massUnit)),
+		lengthUnit, 70.0, { 1.0 / 64, 1.0 / 256, 1.0 / 1024 } };
+	scene.initial = storeOf({
+		pointMass(3.0 * massUnit, lengthUnit * glm::dvec3(1.0, 3.0, 0.0), glm::dvec3(0.0)),
+		pointMass(4.0 * massUnit, lengthUnit * glm::dvec3(-2.0, -1.0, 0.0), glm::dvec3(0.0)),
+		pointMass(5.0 * massUnit, lengthUnit * glm::dvec3(1.0, -1.0, 0.0), glm::dvec3(0.0))
+	});
+	return scene;
+}
+
+// frees the trails and barycenters the scene builder allocated for bodies that only live on in a store
+static void releaseBodies(context& list) {
+	std::vector<Barycenter*> barycenters;
+	for (const std::shared_ptr<GravityBody>& body : list) {
+		delete body->trail;
+		body->trail = nullptr;
+		if (body->barycenter && std::find(barycenters.begin(), barycenters.end(), body->barycenter) == barycenters.end())
+			barycenters.push_back(body->barycenter);
+		body->barycenter = nullptr;
+	}
+	for (Barycenter* barycenter : barycenters) {
+		delete barycenter->primaryOrbit;
+		delete barycenter;
+	}
+	list.clear();
+}
+
+// the solar system scene with its moons, for 10^4 years; the steps are set by Io's orbit of 1.8 days
+// the builder works on the global lists, so those are set aside while it runs
+static AccuracyScene solarScene() {
+	context scene = std::move(bodies);
+	std::vector<std::shared_ptr<Entity>> sceneEntities = std::move(entities);
+	force_engine selected = forceEngine;
+	bodies.clear();
+	entities.clear();
+
+	GravityBodyBuilder().buildSolarSystem();
+	AccuracyScene solar{ "days", 86400.0, 149597.8707, 3652500.0, { 1.0 / 8, 1.0 / 4, 1.0 / 2 } };
+	solar.initial = storeOf(bodies);
+	releaseBodies(bodies);
+
+	bodies = std::move(scene);
+	entities = std::move(sceneEntities);
+	forceEngine = selected;
+	return solar;
+}
+
+// 1000 bodies of the microbenchmark cluster for one dynamical time, before close encounters make
+// the positions of any two runs diverge
+static AccuracyScene plummerScene() {
+	AccuracyScene scene{ "T", sqrt(CLUSTER_RADIUS * CLUSTER_RADIUS * CLUSTER_RADIUS / (G * CLUSTER_MASS)),
+		CLUSTER_RADIUS, 1.0, { 1.0 / 32, 1.0 / 64, 1.0 / 128 } };
+	scene.initial = storeOf(plummerSphere(1000));
+	return scene;
+}
+
+// steps a copy of the scene through its horizon with one configuration and leaves the final positions,
+// timing only the steps; the opening kicks read the forces in the store, so those of the starting positions
+// are computed first; a run whose first step projects it past ACCURACY_TIME_LIMIT, or whose energy stops
+// being finite, is given up with infinite errors
+static AccuracyRun runScene(const AccuracyScene& scene, integration_method method, force_engine engine, double step,
+	double horizonScale, std::vector<glm::dvec3>& positions) {
+	forceEngine = engine;
+	Simulation run;
+	run.integrator = method;
+	run.regularize = doRegularization;
+	run.compensated = doCompensatedSums;
+	run.state = scene.initial;
+	run.reset();
+	run.state.clearForces();
+	computeForces(run.state);
+
+	double duration = scene.horizon * horizonScale * scene.timeUnit;
+	size_t steps = std::max((size_t)1, (size_t)llround(duration / (step * scene.timeUnit)));
+	double dt = duration / steps;
+	double initial = measureConserved(run.state).energy();
+
+	AccuracyRun result{ method, engine, dt, 0.0, 0.0, 0.0, false, false };
+	Clock::time_point first = Clock::now();
+	run.step(dt);
+	result.seconds = std::chrono::duration<double>(Clock::now() - first).count();
+	if (result.seconds * steps > ACCURACY_TIME_LIMIT) {
+		result.seconds *= steps;
+		result.energyError = result.positionError = INFINITY;
+		return result;
+	}
+
+	size_t taken = 1;
+	for (size_t checkpoint = 1; checkpoint <= ACCURACY_CHECKPOINTS; checkpoint++) {
+		size_t until = checkpoint * steps / ACCURACY_CHECKPOINTS;
+		Clock::time_point start = Clock::now();
+		for (; taken < until; taken++)
+			run.step(dt);
+		result.seconds += std::chrono::duration<double>(Clock::now() - start).count();
+
+		double error = fabs((measureConserved(run.state).energy() - initial) / initial);
+		if (!std::isfinite(error)) {
+			result.energyError = result.positionError = INFINITY;
+			break;
+		}
+		result.energyError = std::max(result.energyError, error);
+	}
+
+	positions.resize(run.state.size());
+	for (size_t i = 0; i < run.state.size(); i++)
+		positions[i] = run.state.position(i);
+	return result;
+}
+
+// Hermite, IAS15 and Wisdom-Holman always sum their forces directly, so they are run under that engine alone
+static bool usesForceEngine(integration_method method) {
+	return method == LEAPFROG || method == BLOCK_TIMESTEPS || method >= YOSHIDA_4;
+}
+
+// the Kepler solution of a two-body scene at its horizon, the relative orbit advanced a checkpoint at a time
+static std::vector<glm::dvec3> keplerReference(const AccuracyScene& scene, double horizonScale) {
+	const BodyStore& s = scene.initial;
+	double total = s.mass[0] + s.mass[1];
+	double duration = scene.horizon * horizonScale * scene.timeUnit;
+
+	glm::dvec3 center = (s.mass[0] * s.position(0) + s.mass[1] * s.position(1)) / total;
+	glm::dvec3 centerVelocity = (s.mass[0] * s.velocity(0) + s.mass[1] * s.velocity(1)) / total;
+	glm::dvec3 separation = s.position(1) - s.position(0), relativeVelocity = s.velocity(1) - s.velocity(0);
+	for (size_t k = 0; k < ACCURACY_CHECKPOINTS; k++)
+		keplerDrift(G * total, separation, relativeVelocity, duration / ACCURACY_CHECKPOINTS);
+	center += centerVelocity * duration;
+
+	return { center - s.mass[1] / total * separation, center + s.mass[0] / total * separation };
+}
+
+// a run is on a front when no other run is at least as fast and at least as accurate and better in one of them
+static void markFronts(std::vector<AccuracyRun>& runs) {
+	for (AccuracyRun& run : runs) {
+		run.energyFront = std::isfinite(run.energyError);
+		run.positionFront = std::isfinite(run.positionError);
+		for (const AccuracyRun& other : runs) {
+			if (other.seconds > run.seconds)
+				continue;
+			if (other.energyError <= run.energyError && (other.seconds < run.seconds || other.energyError < run.energyError))
+				run.energyFront = false;
+			if (other.positionError <= run.positionError && (other.seconds < run.seconds || other.positionError < run.positionError))
+				run.positionFront = false;
+		}
+	}
+}
+
+static void printRun(const AccuracyRun& run, const AccuracyScene& scene) {
+	printf("  %-14s %-11s %10.4g %-8s %10.3f %14.3e %14.3e\n", integratorNames[run.integrator], engineNames[run.engine],
+		run.step / scene.timeUnit, scene.timeUnitName, run.seconds, run.energyError, run.positionError);
+}
+
+static void printFront(const std::vector<AccuracyRun>& runs, const AccuracyScene& scene, bool energy) {
+	std::vector<const AccuracyRun*> front;
+	for (const AccuracyRun& run : runs) {
+		if (energy ? run.energyFront : run.positionFront)
+			front.push_back(&run);
+	}
+	std::sort(front.begin(), front.end(), [](const AccuracyRun* a, const AccuracyRun* b) { return a->seconds < b->seconds; });
+
+	printf("pareto front of wall time against %s error:\n", energy ? "energy" : "position");
+	for (const AccuracyRun* run : front)
+		printRun(*run, scene);
+}
+
+// every integrator under every force engine it uses at each step of the standard scenes, or of the one named, ranked by
+// wall time against energy and position error; the two-body orbit is measured against its Kepler solution and
+// the others against IAS15 under direct summation, whose error control picks its own steps within the finest
+// horizonScale shortens or lengthens every scene, and budget is the error both measures must stay within
+// for the fastest configuration that meets it to be named
+void accuracyBenchmark(const char* only, double horizonScale, double budget) {
+	applyThreadSettings();
+	force_engine selected = forceEngine;
+	std::ofstream csv(ACCURACY_CSV);
+	csv << "scene,integrator,engine,step,seconds,energy_error,position_error,energy_front,position_front\n";
+
+	// a scene is only built once chosen, as the solar system goes through the scene builder
+	const struct {
+		const char* name;
+		AccuracyScene (*build)();
+	} scenes[] = { { "kepler", keplerScene }, { "pythagorean", pythagoreanScene }, { "solar", solarScene }, { "plummer", plummerScene } };
+	for (const auto& [name, build] : scenes) {
+		if (only && strcmp(only, name) != 0)
+			continue;
+		AccuracyScene scene = build();
+		printf("\n%s: %zu bodies for %.4g %s\n", name, scene.initial.size(), scene.horizon * horizonScale, scene.timeUnitName);
+
+		std::vector<glm::dvec3> reference, positions;
+		if (scene.analytic)
+			reference = keplerReference(scene, horizonScale);
+		else {
+			double finest = *std::min_element(scene.steps.begin(), scene.steps.end());
+			AccuracyRun run = runScene(scene, GAUSS_RADAU, DIRECT, finest, horizonScale, reference);
+			printf("reference %s %s: %.3f s, energy error %.3e\n",
+				integratorNames[GAUSS_RADAU], engineNames[DIRECT], run.seconds, run.energyError);
+			// a reference given up leaves no positions, and the position errors unavailable
+			if (!std::isfinite(run.energyError)) {
+				reference.clear();
+				printf("reference given up, position errors unavailable\n");
+			}
+		}
+
+		printf("  %-14s %-11s %19s %10s %14s %14s\n", "integrator", "engine", "step", "seconds", "energy error", "position error");
+		std::vector<AccuracyRun> runs;
+		for (double step : scene.steps) {
+			for (uint8_t method = 0; method < INTEGRATOR_COUNT; method++) {
+				for (uint8_t engine = 0; engine < ENGINE_COUNT; engine++) {
+					if (engine != DIRECT && !usesForceEngine((integration_method)method))
+						continue;
+					AccuracyRun run = runScene(scene, (integration_method)method, (force_engine)engine, step, horizonScale, positions);
+					if (std::isfinite(run.energyError) && reference.size() == positions.size()) {
+						double squares = 0.0;
+						for (size_t i = 0; i < positions.size(); i++)
+							squares += glm::dot(positions[i] - reference[i], positions[i] - reference[i]);
+						run.positionError = sqrt(squares / positions.size()) / scene.lengthUnit;
+					}
+					else if (std::isfinite(run.energyError))
+						run.positionError = NAN;
+					printRun(run, scene);
+					runs.push_back(run);
+				}
+			}
+		}
+
+		markFronts(runs);
+		printFront(runs, scene, true);
+		printFront(runs, scene, false);
+
+		const AccuracyRun* fastest = nullptr;
+		for (const AccuracyRun& run : runs) {
+			if (run.energyError <= budget && run.positionError <= budget && (!fastest || run.seconds < fastest->seconds))
+				fastest = &run;
+		}
+		if (fastest) {
+			printf("fastest within an error of %.1e:\n", budget);
+			printRun(*fastest, scene);
+		}
+		else
+			printf("no configuration within an error of %.1e\n", budget);
+
+		for (const AccuracyRun& run : runs) {
+			csv << name << ',' << integratorNames[run.integrator] << ',' << engineNames[run.engine] << ',' << run.step << ','
+				<< run.seconds << ',' << run.energyError << ',' << run.positionError << ','
+				<< run.energyFront << ',' << run.positionFront << '\n';
+		}
+	}
+
+	forceEngine = selected;
+	printf("accuracy runs written to %s\n", ACCURACY_CSV);
+}
\ No newline at end of file
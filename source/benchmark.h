@@ -0,0 +1,48 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include "simulation.h"
+
+// test particles put around the first body by the precision benchmark when the scene has none
+const size_t BENCHMARK_BELT = 100000;
+
+// seconds of repetitions every microbenchmark is timed over, and the body counts of those that scale with N
+const double MICROBENCH_MIN_TIME = 0.25;
+const size_t MICROBENCH_SIZES[] = { 10, 100, 1000, 10000, 100000 };
+const int MICROBENCH_MAX_SUBDIVISIONS = 6;
+// bodies of the cluster the vector kernels are checked against the scalar ones on
+const size_t MICROBENCH_CHECK_SIZE = 1000;
+const char* const MICROBENCH_CSV = "microbench.csv";
+const char* const MICROBENCH_JSON = "microbench.json";
+
+// energy samples of every accuracy run, the seconds past which a run is given up, the error both measures
+// must stay within for a configuration to be recommended, and the file every run is written to
+const size_t ACCURACY_CHECKPOINTS = 100;
+const double ACCURACY_TIME_LIMIT = 600.0;
+const double ACCURACY_BUDGET = 1e-6;
+const char* const ACCURACY_CSV = "accuracy.csv";
+
+// one timed case: n is whatever it scales with, bodies, subdivisions, trail points or secondaries
+struct MicroResult {
+	std::string name;
+	size_t n;
+	size_t iterations;
+	double nanoseconds;	// per iteration
+};
+
+// one configuration of an accuracy scene: the wall time of its steps against the largest relative energy error
+// at any checkpoint and the rms distance of the bodies from the reference at the end, in the scene's length unit
+struct AccuracyRun {
+	integration_method integrator;
+	force_engine engine;
+	double step;	// seconds
+	double seconds, energyError, positionError;	// a run given up keeps its projected time and infinite errors
+	bool energyFront, positionFront;	// on the Pareto front of wall time against that error
+};
+
+void precisionBenchmark(size_t steps, double duration);
+void accuracyBenchmark(const char* only, double horizonScale, double budget);
+std::vector<MicroResult> microBenchmarks();
+bool writeMicroCSV(const std::filesystem::path& path, const std::vector<MicroResult>& results);
+bool writeMicroJSON(const std::filesystem::path& path, const std::vector<MicroResult>& results);
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "blockstep.h"
+#include "rotation.h"
+
+double blockAccuracy = 0.02;
+
+// bodies start on the finest level and climb to their own within the first base step,
+// which costs about one evaluation per level and never takes a body further than it can handle
+void BlockTimesteps::initialize(BodyStore& s) {
+	size_t n = s.size();
+	for (std::vector<double>* field : { &x, &y, &z, &vx, &vy, &vz, &ax, &ay, &az })
+		field->resize(n);
+	level.assign(n, BLOCK_MAX_LEVEL);
+	time.assign(n, 0);
+
+	s.clearForces();
+	computeForces(s);
+	for (size_t i = 0; i < n; i++) {
+		x[i] = s.px[i];
+		y[i] = s.py[i];
+		z[i] = s.pz[i];
+		vx[i] = s.vx[i];
+		vy[i] = s.vy[i];
+		vz[i] = s.vz[i];
+		ax[i] = s.ax[i];
+		ay[i] = s.ay[i];
+		az[i] = s.az[i];
+		s.torque[i] = glm::dvec3(s.tx[i], s.ty[i], s.tz[i]);
+	}
+	initialized = true;
+}
+
+void BlockTimesteps::step(BodyStore& s, double baseDt, double eta) {
+	if (!initialized || level.size() != s.size())
+		initialize(s);
+
+	int n = (int)s.size();
+	double tickDt = baseDt / BLOCK_TICKS;
+	int deepest = 0;
+	evaluations = 0;
+
+	for (int i = 0; i < n; i++)
+		s.prevPosition[i] = glm::dvec3(x[i], y[i], z[i]);
+
+	uint32_t now = 0;
+	while (now < BLOCK_TICKS) {
+		uint32_t next = BLOCK_TICKS;
+		for (int i = 0; i < n; i++)
+			next = std::min(next, time[i] + ticks(level[i]));
+		active.clear();
+		for (int i = 0; i < n; i++) {
+			if (time[i] + ticks(level[i]) == next)
+				active.push_back(i);
+		}
+
+		// every body predicted to the block time, which for the active ones is the drift of velocity Verlet;
+		// the velocities are predicted alongside for the terms that read them, such as the 1PN pairs
+		#pragma omp parallel for
+		for (int i = 0; i < n; i++) {
+			double dt = (next - time[i]) * tickDt;
+			double half = 0.5 * dt * dt;
+			s.px[i] = x[i] + vx[i] * dt + ax[i] * half;
+			s.py[i] = y[i] + vy[i] * dt + ay[i] * half;
+			s.pz[i] = z[i] + vz[i] * dt + az[i] * half;
+			s.vx[i] = vx[i] + ax[i] * dt;
+			s.vy[i] = vy[i] + ay[i] * dt;
+			s.vz[i] = vz[i] + az[i] * dt;
+		}
+
+		#pragma omp parallel for
+		for (int k = 0; k < (int)active.size(); k++) {
+			uint32_t i = active[k];
+			double h = ticks(level[i]) * tickDt;
+			s.angularMomentum[i] += s.torque[i] * (0.5 * h);
+			rotateBody(s, i, h);
+		}
+
+		computeForces(s, active);
+		evaluations += active.size();
+
+		#pragma omp parallel for
+		for (int k = 0; k < (int)active.size(); k++) {
+			uint32_t i = active[k];
+			double h = ticks(level[i]) * tickDt;
+			glm::dvec3 before(ax[i], ay[i], az[i]);
+			glm::dvec3 after = s.acceleration(i);
+
+			vx[i] += 0.5 * (before.x + after.x) * h;
+			vy[i] += 0.5 * (before.y + after.y) * h;
+			vz[i] += 0.5 * (before.z + after.z) * h;
+			x[i] = s.px[i];
+			y[i] = s.py[i];
+			z[i] = s.pz[i];
+			ax[i] = after.x;
+			ay[i] = after.y;
+			az[i] = after.z;
+			time[i] = next;
+
+			s.torque[i] = glm::dvec3(s.tx[i], s.ty[i], s.tz[i]);
+			s.angularMomentum[i] += s.torque[i] * (0.5 * h);
+
+			// timescale from the change of acceleration over the step just taken
+			double change = glm::length(after - before);
+			int desired = 0;
+			if (change > 0.0) {
+				double timescale = eta * glm::length(after) * h / change;
+				desired = (int)ceil(log2(baseDt / timescale));
+				desired = std::max(0, std::min(desired, BLOCK_MAX_LEVEL));
+			}
+			if (desired > level[i])
+				level[i] = (uint8_t)desired;
+			else if (desired < level[i] && next % ticks(level[i] - 1) == 0)
+				level[i]--;
+		}
+
+		for (uint32_t i : active)
+			deepest = std::max(deepest, (int)level[i]);
+		now = next;
+	}
+
+	// the base step ends with every body synchronized
+	#pragma omp parallel for
+	for (int i = 0; i < n; i++) {
+		s.px[i] = x[i];
+		s.py[i] = y[i];
+		s.pz[i] = z[i];
+		s.vx[i] = vx[i];
+		s.vy[i] = vy[i];
+		s.vz[i] = vz[i];
+		s.ax[i] = ax[i];
+		s.ay[i] = ay[i];
+		s.az[i] = az[i];
+		time[i] = 0;
+	}
+
+	depth = deepest;
+}
\ No newline at end of file
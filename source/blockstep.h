@@ -0,0 +1,32 @@
+#pragma once
+
+#include "forces.h"
+
+// the base step is split into at most 2^BLOCK_MAX_LEVEL substeps, counted in ticks of the finest level
+const int BLOCK_MAX_LEVEL = 16;
+const uint32_t BLOCK_TICKS = 1u << BLOCK_MAX_LEVEL;
+
+extern double blockAccuracy;		// eta of the timestep criterion
+
+// Aarseth-style individual block timesteps
+// every body advances with a power-of-two fraction of the base step picked from its own timescale eta |a| / |da/dt|,
+// and only moves to a coarser level when its time lines up with that level's grid
+// at each block time the active bodies get new forces against positions of the others predicted to second order;
+// each body follows velocity Verlet on its own step, which is the kick-drift-kick leapfrog when all share one level
+class BlockTimesteps {
+public:
+	void step(BodyStore& s, double baseDt, double eta);
+	void reset() { initialized = false; }
+
+	int depth = 0;				// finest level in use during the last base step
+	size_t evaluations = 0;		// bodies whose forces were evaluated during the last base step
+private:
+	bool initialized = false;
+	std::vector<uint8_t> level;
+	std::vector<uint32_t> time;		// ticks into the base step at which each body was last updated
+	std::vector<double> x, y, z, vx, vy, vz, ax, ay, az;	// state of each body at its own time
+	std::vector<uint32_t> active;
+
+	void initialize(BodyStore& s);
+	uint32_t ticks(int level) const { return BLOCK_TICKS >> level; }
+};
\ No newline at end of file
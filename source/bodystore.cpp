@@ -0,0 +1,140 @@
+#include "bodystore.h"
+
+void BodyStore::resize(size_t n) {
+	for (std::vector<double>* field : {
+		&px, &py, &pz, &vx, &vy, &vz, &ax, &ay, &az, &jx, &jy, &jz,
+		&mass, &radius, &j2, &sx, &sy, &sz, &tx, &ty, &tz, &cpx, &cpy, &cpz, &cvx, &cvy, &cvz })
+		field->assign(n, 0.0);
+
+	gravityType.assign(n, POINT);
+	parent.assign(n, (size_t)-1);
+	orientation.assign(n, glm::dquat(1.0, 0.0, 0.0, 0.0));
+	angularMomentum.assign(n, glm::dvec3(0.0));
+	torque.assign(n, glm::dvec3(0.0));
+	momentOfInertia.assign(n, glm::dvec3(0.0));
+	prevPosition.assign(n, glm::dvec3(0.0));
+}
+
+// gather the state of every body into the store
+// torque accumulators survive a reload as long as the number of bodies is unchanged
+void BodyStore::load(const context& bodies) {
+	if (bodies.size() != size())
+		resize(bodies.size());
+
+	for (size_t i = 0; i < bodies.size(); i++) {
+		const GravityBody& body = *bodies[i];
+
+		px[i] = body.position.x;
+		py[i] = body.position.y;
+		pz[i] = body.position.z;
+		vx[i] = body.velocity.x;
+		vy[i] = body.velocity.y;
+		vz[i] = body.velocity.z;
+		ax[i] = body.acceleration.x;
+		ay[i] = body.acceleration.y;
+		az[i] = body.acceleration.z;
+
+		mass[i] = body.mass;
+		radius[i] = body.radius;
+		j2[i] = body.j2;
+		gravityType[i] = body.gravityType;
+		parent[i] = body.parentIndex;
+
+		orientation[i] = body.rotQuat;
+		angularMomentum[i] = body.angularMomentum;
+		torque[i] = body.torque;
+		momentOfInertia[i] = body.momentOfInertia;
+		prevPosition[i] = body.prevPosition;
+
+		refreshAxis(i);
+	}
+	clearCarries();
+}
+
+// scatter the integrated state back to the bodies for rendering, logging and barycenter queries
+void BodyStore::publish(context& bodies) const {
+	for (size_t i = 0; i < bodies.size() && i < size(); i++) {
+		GravityBody& body = *bodies[i];
+
+		body.prevPosition = prevPosition[i];
+		body.position = position(i);
+		body.velocity = velocity(i);
+		body.acceleration = acceleration(i);
+
+		body.mass = mass[i];
+		body.radius = radius[i];
+
+		body.rotQuat = orientation[i];
+		body.angularMomentum = angularMomentum[i];
+		body.torque = torque[i];
+	}
+}
+
+void BodyStore::clearForces() {
+	std::fill(ax.begin(), ax.end(), 0.0);
+	std::fill(ay.begin(), ay.end(), 0.0);
+	std::fill(az.begin(), az.end(), 0.0);
+	std::fill(tx.begin(), tx.end(), 0.0);
+	std::fill(ty.begin(), ty.end(), 0.0);
+	std::fill(tz.begin(), tz.end(), 0.0);
+	std::fill(jx.begin(), jx.end(), 0.0);
+	std::fill(jy.begin(), jy.end(), 0.0);
+	std::fill(jz.begin(), jz.end(), 0.0);
+}
+
+void BodyStore::refreshAxis(size_t i) {
+	glm::dvec3 axisOfRotation = glm::normalize(orientation[i] * glm::dvec3(0.0, 1.0, 0.0));
+	sx[i] = axisOfRotation.x;
+	sy[i] = axisOfRotation.y;
+	sz[i] = axisOfRotation.z;
+}
+
+// moves every body to its destination index and drops those whose destination is -1
+// destinations of the kept bodies must be increasing, so each body moves down at most
+void BodyStore::compact(const std::vector<size_t>& destination) {
+	size_t kept = 0;
+	for (size_t i = 0; i < size(); i++) {
+		size_t to = destination[i];
+		if (to == (size_t)-1)
+			continue;
+		kept = to + 1;
+		if (to == i)
+			continue;
+
+		for (std::vector<double>* field : {
+			&px, &py, &pz, &vx, &vy, &vz, &ax, &ay, &az, &jx, &jy, &jz,
+			&mass, &radius, &j2, &sx, &sy, &sz, &tx, &ty, &tz, &cpx, &cpy, &cpz, &cvx, &cvy, &cvz })
+			(*field)[to] = (*field)[i];
+
+		gravityType[to] = gravityType[i];
+		parent[to] = parent[i];
+		orientation[to] = orientation[i];
+		angularMomentum[to] = angularMomentum[i];
+		torque[to] = torque[i];
+		momentOfInertia[to] = momentOfInertia[i];
+		prevPosition[to] = prevPosition[i];
+	}
+
+	for (std::vector<double>* field : {
+		&px, &py, &pz, &vx, &vy, &vz, &ax, &ay, &az, &jx, &jy, &jz,
+		&mass, &radius, &j2, &sx, &sy, &sz, &tx, &ty, &tz, &cpx, &cpy, &cpz, &cvx, &cvy, &cvz })
+		field->resize(kept);
+	gravityType.resize(kept);
+	parent.resize(kept);
+	orientation.resize(kept);
+	angularMomentum.resize(kept);
+	torque.resize(kept);
+	momentOfInertia.resize(kept);
+	prevPosition.resize(kept);
+}
+
+// forgets what compensated steps kept below the last bit, for when the state is set from outside
+void BodyStore::clearCarries() {
+	for (std::vector<double>* field : { &cpx, &cpy, &cpz, &cvx, &cvy, &cvz })
+		std::fill(field->begin(), field->end(), 0.0);
+}
+
+void BodyStore::clearCarry(size_t i) {
+	cpx[i] = cpy[i] = cpz[i] = 0.0;
+	cvx[i] = cvy[i] = cvz[i] = 0.0;
+}
\ No newline at end of file
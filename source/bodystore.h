@@ -0,0 +1,41 @@
+#pragma once
+
+#include "gravitybody.h"
+
+// contiguous structure-of-arrays copy of the physical state of a context
+// the physics thread integrates this store directly and publishes results back to the bodies
+class BodyStore {
+public:
+	std::vector<double> px, py, pz;	// position
+	std::vector<double> vx, vy, vz;	// velocity
+	std::vector<double> ax, ay, az;	// acceleration
+	std::vector<double> jx, jy, jz;	// jerk, only filled by passes that ask for it
+	std::vector<double> mass, radius, j2;
+	std::vector<double> sx, sy, sz;	// axis of rotation in world space
+	std::vector<double> tx, ty, tz;	// torque accumulated by the current force pass
+	std::vector<double> cpx, cpy, cpz, cvx, cvy, cvz;	// low-order parts of position and velocity left over by compensated steps
+	std::vector<gravType> gravityType;
+	std::vector<size_t> parent;		// body each one orbits, -1 for none
+
+	// rotational state
+	std::vector<glm::dquat> orientation;
+	std::vector<glm::dvec3> angularMomentum, torque, momentOfInertia;
+	std::vector<glm::dvec3> prevPosition;
+
+	size_t size() const { return mass.size(); }
+
+	void resize(size_t n);
+	void load(const context& bodies);
+	void publish(context& bodies) const;
+	void clearForces();
+	void refreshAxis(size_t i);
+	void clearCarries();
+	void clearCarry(size_t i);
+	void compact(const std::vector<size_t>& destination);
+
+	glm::dvec3 position(size_t i) const { return glm::dvec3(px[i], py[i], pz[i]); }
+	glm::dvec3 velocity(size_t i) const { return glm::dvec3(vx[i], vy[i], vz[i]); }
+	glm::dvec3 acceleration(size_t i) const { return glm::dvec3(ax[i], ay[i], az[i]); }
+	glm::dvec3 jerk(size_t i) const { return glm::dvec3(jx[i], jy[i], jz[i]); }
+	glm::dvec3 axis(size_t i) const { return glm::dvec3(sx[i], sy[i], sz[i]); }
+};
\ No newline at end of file
@@ -1,4 +1,7 @@
 #include "builder.h"
+#include "particlemesh.h"
+#include "physics.h"
+#include <random>
 
 void EntityBuilder::buildSky(size_t modelIndex) {
 	std::vector<std::string> faces = {
@@ -19,6 +22,8 @@ void EntityBuilder::buildSky(size_t modelIndex) {
 }
 
 void GravityBodyBuilder::buildSolarSystem() {
+	forceEngine = DIRECT;
+
 	size_t sphere = Model::Icosphere(5);
 	glm::vec4 diffuseMat(0.0f, 1.0f, 0.0f, 0.0f);
 	Surface sun = Surface("../../assets/sol/sun.jpg", glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
@@ -185,6 +190,8 @@ void GravityBodyBuilder::buildSolarSystem() {
 }
 
 void GravityBodyBuilder::buildAlienSystem() {
+	forceEngine = DIRECT;
+
 	size_t sphere = Model::Icosphere(5);
 	size_t square = Model::Square();
 	glm::vec4 diffuseMat(0.0f, 1.0f, 0.0f, 0.0f);
@@ -361,6 +368,8 @@ void GravityBodyBuilder::buildAlienSystem() {
 }
 
 void GravityBodyBuilder::buildTestSystem() {
+	forceEngine = DIRECT;
+
 	size_t sphere = Model::Icosphere(4);
 	glm::vec4 diffuseMat(0.0f, 1.0f, 0.0f, 0.0f);
 	glm::vec4 ambMat(1.0f, 0.0f, 0.0f, 0.0f);
@@ -395,6 +404,68 @@ void GravityBodyBuilder::buildTestSystem() {
 	addToBodiesLists();
 }
 
+// Plummer sphere of equal masses, sampled as in Aarseth, Henon & Wielen (1974) and truncated at 20 scale radii
+void GravityBodyBuilder::buildCluster(size_t count, double totalMass, double scaleRadius) {
+	forceEngine = PARTICLE_MESH;
+
+	size_t sphere = Model::Icosphere(1);
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<double> uniform(0.0, 1.0);
+	auto isotropic = [&](double length) {
+		double z = 2.0 * uniform(rng) - 1.0;
+		double phi = 2.0 * pi * uniform(rng);
+		double planar = sqrt(1.0 - z * z);
+		return length * glm::dvec3(planar * cos(phi), planar * sin(phi), z);
+	};
+
+	for (size_t i = 0; i < count; i++) {
+		double radius;
+		do {
+			radius = scaleRadius / sqrt(pow(uniform(rng), -2.0 / 3.0) - 1.0);
+		} while (radius > 20.0 * scaleRadius);
+
+		// speed as a fraction q of the local escape speed, drawn from q^2 (1 - q^2)^(7/2) by rejection
+		double q, y;
+		do {
+			q = uniform(rng);
+			y = 0.1 * uniform(rng);
+		} while (y > q * q * pow(1.0 - q * q, 3.5));
+		double escape = sqrt(2.0 * G * totalMass / sqrt(radius * radius + scaleRadius * scaleRadius));
+
+		init(totalMass / count);
+		setModel(sphere);
+		setRadius((float)(scaleRadius * 1e-3));
+		setMotion(isotropic(radius), isotropic(q * escape));
+		addToBodiesLists();
+	}
+}
+
+// test particles on circular orbits around a body, spread evenly over the area between two radii, each orbit
+// tilted out of the parent's orbital plane by up to the given inclination; only the parent's mass sets the speeds
+// singlePrecision puts them with the float particles, which step twice as many per vector
+void GravityBodyBuilder::buildBelt(size_t parentIndex, size_t count, double innerRadius, double outerRadius, double inclination, bool singlePrecision) {
+	const GravityBody& parent = *bodies[parentIndex];
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+	for (size_t i = 0; i < count; i++) {
+		double radius = sqrt(innerRadius * innerRadius + uniform(rng) * (outerRadius * outerRadius - innerRadius * innerRadius));
+		double anomaly = 2.0 * pi * uniform(rng);
+		double node = 2.0 * pi * uniform(rng);
+		double tilt = inclination * (2.0 * uniform(rng) - 1.0);
+
+		// circular orbit in the x-z plane, then tilted about its line of nodes
+		glm::dvec3 position = radius * glm::dvec3(cos(anomaly), 0.0, sin(anomaly));
+		glm::dvec3 velocity = sqrt(G * parent.mass / radius) * glm::dvec3(-sin(anomaly), 0.0, cos(anomaly));
+		glm::dquat rotation = glm::angleAxis(tilt, glm::dvec3(cos(node), 0.0, sin(node)));
+
+		if (singlePrecision)
+			simulation.floatParticles.add(parent.position + rotation * position, parent.velocity + rotation * velocity);
+		else
+			simulation.particles.add(parent.position + rotation * position, parent.velocity + rotation * velocity);
+	}
+}
+
 // adjust motion of all bodies in the world to achieve net zero motion relative to the world space
 static void fixSystemToWorldSpace() {
 	glm::dvec3 avgPos(0.0), avgVel(0.0);
@@ -412,6 +483,19 @@ static void fixSystemToWorldSpace() {
 		body->position -= avgPos;
 		body->velocity -= avgVel;
 	}
+
+	auto shift = [&](auto& particles) {
+		for (size_t i = 0; i < particles.size(); i++) {
+			particles.px[i] -= avgPos.x;
+			particles.py[i] -= avgPos.y;
+			particles.pz[i] -= avgPos.z;
+			particles.vx[i] -= avgVel.x;
+			particles.vy[i] -= avgVel.y;
+			particles.vz[i] -= avgVel.z;
+		}
+	};
+	shift(simulation.particles);
+	shift(simulation.floatParticles);
 }
 
 void buildObjects() {
@@ -423,6 +507,8 @@ void buildObjects() {
 	//builder.buildSolarSystem();
 	//builder.buildAlienSystem();
 	builder.buildTestSystem();
+	//builder.buildCluster(100000, 2e35, 3e10);
+	//builder.buildBelt(0, 1000000, 2e4, 4e4, 0.05);
 
 	/*
 	// cross section of ring structure
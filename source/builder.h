@@ -124,6 +124,8 @@ public:
 	void buildSolarSystem();
 	void buildAlienSystem();
 	void buildTestSystem();
+	void buildCluster(size_t count, double totalMass, double scaleRadius);
+	void buildBelt(size_t parentIndex, size_t count, double innerRadius, double outerRadius, double inclination, bool singlePrecision = false);
 };
 
 void buildObjects();
\ No newline at end of file
@@ -0,0 +1,281 @@
+#include "collisions.h"
+#include "profiler.h"
+
+// whether the centers of a and b came within the merge distance at any time of the last step,
+// with both moving in a straight line from their previous positions
+bool sweptContact(const BodyStore& s, size_t a, size_t b) {
+	glm::dvec3 start = s.prevPosition[a] - s.prevPosition[b];
+	glm::dvec3 travel = (s.position(a) - s.position(b)) - start;
+
+	double t = 0.0;
+	double length2 = glm::dot(travel, travel);
+	if (length2 > 0.0)
+		t = std::clamp(-glm::dot(start, travel) / length2, 0.0, 1.0);
+
+	glm::dvec3 closest = start + travel * t;
+	double reach = MERGE_FRACTION * std::max(s.radius[a], s.radius[b]);
+	return glm::dot(closest, closest) < reach * reach;
+}
+
+// linear in x, so a row of cells lies in consecutive slots and the lookups of neighbouring bodies stream through memory
+static inline uint64_t cellHash(const GridCell& cell) {
+	return (uint64_t)cell.x + (uint64_t)cell.y * 0x9E3779B1ull + (uint64_t)cell.z * 0x85EBCA77ull;
+}
+
+static inline bool overlap(const SweptBounds& a, const SweptBounds& b) {
+	return a.lower.x <= b.upper.x && b.lower.x <= a.upper.x &&
+		a.lower.y <= b.upper.y && b.lower.y <= a.upper.y &&
+		a.lower.z <= b.upper.z && b.lower.z <= a.upper.z;
+}
+
+void Collisions::broadPhase(const BodyStore& s) {
+	int n = (int)s.size();
+	bounds.resize(n);
+	cells.resize(n);
+
+	std::vector<double> extent(n);
+	#pragma omp parallel for
+	for (int i = 0; i < n; i++) {
+		glm::dvec3 position = s.position(i);
+		double reach = MERGE_FRACTION * s.radius[i];
+		bounds[i].lower = glm::min(position, s.prevPosition[i]) - reach;
+		bounds[i].upper = glm::max(position, s.prevPosition[i]) + reach;
+		glm::dvec3 size = bounds[i].upper - bounds[i].lower;
+		extent[i] = std::max(size.x, std::max(size.y, size.z));
+	}
+	glm::dvec3 origin(DBL_MAX);
+	for (int i = 0; i < n; i++)
+		origin = glm::min(origin, bounds[i].lower);
+
+	// cells sized from the typical box, so that two boxes no larger than a cell overlap only
+	// when the cells of their lower corners are neighbours; the grid starts at the lowest corner
+	std::vector<double> typical = extent;
+	std::nth_element(typical.begin(), typical.begin() + n / 2, typical.end());
+	cellSize = GRID_CELL_FACTOR * typical[n / 2];
+	if (!(cellSize > 0.0))
+		cellSize = std::max(1.0, *std::max_element(extent.begin(), extent.end()));
+
+	// counting sort of the bodies into the slots of a hash table twice their number
+	size_t slots = 1;
+	while (slots < 2 * (size_t)n)
+		slots <<= 1;
+	start.assign(slots + 1, 0);
+	oversized.clear();
+	GridCell lowest{ INT64_MAX, INT64_MAX, INT64_MAX }, highest{ INT64_MIN, INT64_MIN, INT64_MIN };
+	for (int i = 0; i < n; i++) {
+		GridCell& cell = cells[i];
+		glm::dvec3 corner = (bounds[i].lower - origin) / cellSize;
+		cell = GridCell{ (int64_t)corner.x, (int64_t)corner.y, (int64_t)corner.z };
+		if (extent[i] > cellSize) {
+			oversized.push_back(i);
+			continue;
+		}
+		start[(cellHash(cell) & (slots - 1)) + 1]++;
+		lowest = GridCell{ std::min(lowest.x, cell.x), std::min(lowest.y, cell.y), std::min(lowest.z, cell.z) };
+		highest = GridCell{ std::max(highest.x, cell.x), std::max(highest.y, cell.y), std::max(highest.z, cell.z) };
+	}
+	for (size_t k = 0; k < slots; k++)
+		start[k + 1] += start[k];
+	slotted.resize(start[slots]);
+	slottedCells.resize(start[slots]);
+	std::vector<uint32_t> fill(start.begin(), start.end() - 1);
+	for (int i = 0; i < n; i++) {
+		if (extent[i] > cellSize)
+			continue;
+		uint32_t k = fill[cellHash(cells[i]) & (slots - 1)]++;
+		slotted[k] = i;
+		slottedCells[k] = cells[i];
+	}
+
+	// each pair of neighbouring cells is visited from one side only: the home cell and the 13 neighbours after it,
+	// leaving out those past the occupied range, which for a flat system is most of them
+	std::vector<GridCell> forward;
+	for (int64_t dx = 0; dx <= 1; dx++) {
+		for (int64_t dy = dx ? -1 : 0; dy <= 1; dy++) {
+			for (int64_t dz = dx || dy ? -1 : 0; dz <= 1; dz++) {
+				if (lowest.x + dx <= highest.x && lowest.y + std::abs(dy) <= highest.y && lowest.z + std::abs(dz) <= highest.z)
+					forward.push_back(GridCell{ dx, dy, dz });
+			}
+		}
+	}
+
+	contacts.clear();
+	#pragma omp parallel
+	{
+		std::vector<std::pair<uint32_t, uint32_t>> found;
+
+		#pragma omp for schedule(dynamic, 256)
+		for (int k = 0; k < (int)slotted.size(); k++) {
+			uint32_t a = slotted[k];
+			const GridCell& home = slottedCells[k];
+			for (const GridCell& offset : forward) {
+				GridCell cell{ home.x + offset.x, home.y + offset.y, home.z + offset.z };
+				bool same = offset.x == 0 && offset.y == 0 && offset.z == 0;
+				size_t slot = cellHash(cell) & (slots - 1);
+				for (uint32_t m = start[slot]; m < start[slot + 1]; m++) {
+					// bodies of other cells hashed into the same slot are skipped
+					const GridCell& other = slottedCells[m];
+					if ((same && m <= (uint32_t)k) || other.x != cell.x || other.y != cell.y || other.z != cell.z)
+						continue;
+					uint32_t b = slotted[m];
+					if (overlap(bounds[a], bounds[b]) && sweptContact(s, a, b))
+						found.emplace_back(std::min(a, b), std::max(a, b));
+				}
+			}
+		}
+
+		// the few bodies too large or too fast for a cell against everything
+		#pragma omp for schedule(dynamic, 1)
+		for (int k = 0; k < (int)oversized.size(); k++) {
+			uint32_t a = oversized[k];
+			for (int b = 0; b < n; b++) {
+				if ((uint32_t)b == a || (extent[b] > cellSize && (uint32_t)b < a))
+					continue;
+				if (overlap(bounds[a], bounds[b]) && sweptContact(s, a, b))
+					found.emplace_back(std::min(a, (uint32_t)b), std::max(a, (uint32_t)b));
+			}
+		}
+
+		#pragma omp critical
+		contacts.insert(contacts.end(), found.begin(), found.end());
+	}
+}
+
+uint32_t Collisions::find(uint32_t i) {
+	while (group[i] != i) {
+		group[i] = group[group[i]];
+		i = group[i];
+	}
+	return i;
+}
+
+// every group of bodies in contact becomes its most massive member, which takes on the total mass and volume,
+// the momentum, and the angular momentum including that of the members' motion about their barycenter
+void Collisions::merge(BodyStore& s) {
+	size_t n = s.size();
+	group.resize(n);
+	for (size_t i = 0; i < n; i++)
+		group[i] = (uint32_t)i;
+
+	// the root of every group is its most massive body, the lower index on ties
+	for (const std::pair<uint32_t, uint32_t>& contact : contacts) {
+		uint32_t a = find(contact.first), b = find(contact.second);
+		if (a == b)
+			continue;
+		bool aHolds = s.mass[a] > s.mass[b] || (s.mass[a] == s.mass[b] && a < b);
+		if (aHolds)
+			group[b] = a;
+		else
+			group[a] = b;
+	}
+
+	struct Total {
+		double mass = 0.0, volume = 0.0;
+		glm::dvec3 position{ 0.0 }, previous{ 0.0 }, momentum{ 0.0 }, force{ 0.0 }, jerk{ 0.0 };
+		glm::dvec3 spin{ 0.0 }, orbital{ 0.0 }, torque{ 0.0 };
+	};
+	// only bodies in some contact belong to a group of more than one
+	std::vector<uint8_t> touched(n, 0);
+	for (const std::pair<uint32_t, uint32_t>& contact : contacts)
+		touched[contact.first] = touched[contact.second] = 1;
+
+	std::vector<uint32_t> slot(n, UINT32_MAX);
+	std::vector<uint32_t> holders;
+	std::vector<Total> totals;
+	absorbed.assign(n, 0);
+	for (size_t i = 0; i < n; i++) {
+		if (!touched[i])
+			continue;
+		uint32_t root = find((uint32_t)i);
+		if (slot[root] == UINT32_MAX) {
+			slot[root] = (uint32_t)totals.size();
+			holders.push_back(root);
+			totals.emplace_back();
+		}
+		Total& total = totals[slot[root]];
+		double m = s.mass[i];
+		total.mass += m;
+		total.volume += s.radius[i] * s.radius[i] * s.radius[i];
+		total.position += m * s.position(i);
+		total.previous += m * s.prevPosition[i];
+		total.momentum += m * s.velocity(i);
+		total.force += m * s.acceleration(i);
+		total.jerk += m * s.jerk(i);
+		total.spin += s.angularMomentum[i];
+		total.orbital += m * glm::cross(s.position(i), s.velocity(i));
+		total.torque += s.torque[i];
+		absorbed[i] = root != i;
+	}
+
+	for (size_t k = 0; k < holders.size(); k++) {
+		uint32_t i = holders[k];
+		const Total& total = totals[k];
+
+		glm::dvec3 center = total.position / total.mass;
+		glm::dvec3 velocity = total.momentum / total.mass;
+		glm::dvec3 acceleration = total.force / total.mass;
+		glm::dvec3 jerk = total.jerk / total.mass;
+		double radius = cbrt(total.volume);
+
+		// moment of inertia keeps its shape, scaled to the new mass and size
+		double before = s.mass[i] * s.radius[i] * s.radius[i];
+		if (before > 0.0)
+			s.momentOfInertia[i] *= total.mass * radius * radius / before;
+
+		s.angularMomentum[i] = total.spin + total.orbital - total.mass * glm::cross(center, velocity);
+		s.torque[i] = total.torque;
+		s.mass[i] = total.mass;
+		s.radius[i] = radius;
+		s.prevPosition[i] = total.previous / total.mass;
+		s.px[i] = center.x;
+		s.py[i] = center.y;
+		s.pz[i] = center.z;
+		s.vx[i] = velocity.x;
+		s.vy[i] = velocity.y;
+		s.vz[i] = velocity.z;
+		s.ax[i] = acceleration.x;
+		s.ay[i] = acceleration.y;
+		s.az[i] = acceleration.z;
+		s.jx[i] = jerk.x;
+		s.jy[i] = jerk.y;
+		s.jz[i] = jerk.z;
+	}
+
+	// new indices of the bodies that remain, and of the holder for those absorbed
+	std::vector<size_t> destination(n, (size_t)-1);
+	size_t kept = 0;
+	for (size_t i = 0; i < n; i++) {
+		if (!absorbed[i])
+			destination[i] = kept++;
+	}
+	remap.resize(n);
+	for (size_t i = 0; i < n; i++)
+		remap[i] = destination[find((uint32_t)i)];
+
+	// parents follow the bodies they merged into, a body that absorbed its own parent orbits nothing
+	for (size_t i = 0; i < n; i++) {
+		size_t parent = s.parent[i];
+		if (parent < n) {
+			parent = remap[parent];
+			s.parent[i] = parent == remap[i] ? (size_t)-1 : parent;
+		}
+	}
+
+	s.compact(destination);
+	merges = n - kept;
+}
+
+// returns whether any bodies merged, in which case the store is compacted and remap describes the change
+bool Collisions::resolve(BodyStore& s) {
+	PhaseTimer timer(PHASE_MERGE);
+	merges = 0;
+	if (s.size() < 2)
+		return false;
+
+	broadPhase(s);
+	if (contacts.empty())
+		return false;
+
+	merge(s);
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "bodystore.h"
+
+// two bodies merge when their centers pass within this fraction of the larger radius during a step
+const double MERGE_FRACTION = 0.2;
+// edge of a cell of the broad-phase grid in median box sizes, larger boxes than a cell are checked against every body
+const double GRID_CELL_FACTOR = 2.0;
+
+// box around the path of a body over the last step, widened by the part of its radius that can merge
+struct SweptBounds {
+	glm::dvec3 lower, upper;
+};
+
+struct GridCell {
+	int64_t x, y, z;
+};
+
+// collision detection and merging on the store, run once per step
+// broad phase: uniform spatial hash of the boxes swept by every body since its previous position
+// narrow phase: closest approach of the two straight paths, so fast bodies can't pass through each other
+// between steps; chains of contacts merge into their most massive body, and the store is compacted once
+class Collisions {
+public:
+	size_t merges = 0;					// bodies absorbed during the last pass
+	std::vector<size_t> remap;			// for every body before the last pass, the new index of the body now holding it
+	std::vector<uint8_t> absorbed;		// bodies removed by the last pass
+
+	bool resolve(BodyStore& s);
+private:
+	double cellSize = 0.0;
+	std::vector<SweptBounds> bounds;
+	std::vector<GridCell> cells;		// cell of the lower corner of every box
+	std::vector<uint32_t> start;		// range of slotted held by each slot of the hash table
+	std::vector<uint32_t> slotted;		// bodies grouped by hash slot
+	std::vector<GridCell> slottedCells;	// their cells, in the same order
+	std::vector<uint32_t> oversized;	// bodies whose box is larger than a cell
+	std::vector<uint32_t> group;		// union-find forest of the bodies in contact
+	std::vector<std::pair<uint32_t, uint32_t>> contacts;
+
+	void broadPhase(const BodyStore& s);
+	uint32_t find(uint32_t i);
+	void merge(BodyStore& s);
+};
+
+bool sweptContact(const BodyStore& s, size_t a, size_t b);
\ No newline at end of file
@@ -0,0 +1,106 @@
+#include "conservation.h"
+#include "octree.h"
+#include "symplectic.h"
+#include "profiler.h"
+
+// every quantity including the carries of compensated steps, summed with compensation across bodies
+Conserved measureConserved(const BodyStore& s) {
+	int n = (int)s.size();
+	Conserved c;
+
+	// potential energy of every body in the field of those after it, or the whole total from the tree
+	std::vector<double> pairEnergy;
+	if (s.size() > CONSERVATION_DIRECT_LIMIT)
+		c.potential = treePotential(s, CONSERVATION_THETA);
+	else {
+		pairEnergy.assign(n, 0.0);
+		#pragma omp parallel for schedule(dynamic, 64)
+		for (int i = 0; i < n; i++) {
+			glm::dvec3 position = s.position(i) + glm::dvec3(s.cpx[i], s.cpy[i], s.cpz[i]);
+			double sum = 0.0;
+			for (int j = i + 1; j < n; j++) {
+				glm::dvec3 other = s.position(j) + glm::dvec3(s.cpx[j], s.cpy[j], s.cpz[j]);
+				sum -= s.mass[j] / glm::distance(position, other);
+			}
+			pairEnergy[i] = G * s.mass[i] * sum;
+		}
+	}
+
+	double kinetic = 0.0, kineticCarry = 0.0, potential = 0.0, potentialCarry = 0.0;
+	for (int i = 0; i < n; i++) {
+		double m = s.mass[i];
+		glm::dvec3 position = s.position(i) + glm::dvec3(s.cpx[i], s.cpy[i], s.cpz[i]);
+		glm::dvec3 velocity = s.velocity(i) + glm::dvec3(s.cvx[i], s.cvy[i], s.cvz[i]);
+		CompensatedSum::add(kinetic, kineticCarry, 0.5 * m * glm::dot(velocity, velocity));
+		if (!pairEnergy.empty())
+			CompensatedSum::add(potential, potentialCarry, pairEnergy[i]);
+
+		// spin energy from the angular momentum in the body frame
+		glm::dvec3 spin = glm::conjugate(s.orientation[i]) * s.angularMomentum[i];
+		const glm::dvec3& inertia = s.momentOfInertia[i];
+		for (int axis = 0; axis < 3; axis++) {
+			if (inertia[axis] > 0.0)
+				CompensatedSum::add(kinetic, kineticCarry, 0.5 * spin[axis] * spin[axis] / inertia[axis]);
+		}
+
+		glm::dvec3 orbital = m * glm::cross(position, velocity);
+		c.momentum += m * velocity;
+		c.angularMomentum += orbital + s.angularMomentum[i];
+		c.momentumScale += m * glm::length(velocity);
+		c.angularScale += glm::length(orbital) + glm::length(s.angularMomentum[i]);
+	}
+	c.kinetic = kinetic + kineticCarry;
+	if (!pairEnergy.empty())
+		c.potential = potential + potentialCarry;
+	return c;
+}
+
+bool beyondPointMasses(const BodyStore& s) {
+	bool oblate = std::find(s.gravityType.begin(), s.gravityType.end(), OBLATE_SPHERE) != s.gravityType.end();
+	return postNewtonian || (oblateGravity && oblate);
+}
+
+// the next sample becomes the baseline, for when the system was replaced
+void ConservationMonitor::restart() {
+	sampled = false;
+	counter = 0;
+	elapsed = 0.0;
+	time = energyDrift = momentumDrift = angularDrift = 0.0;
+	pointMassesOnly = true;
+}
+
+// takes the baseline before the first monitored step
+void ConservationMonitor::begin(const BodyStore& s) {
+	if (interval > 0 && !sampled)
+		sample(s);
+}
+
+// counts the steps of the simulation a call covered and samples once the interval is reached
+void ConservationMonitor::step(const BodyStore& s, double dt, size_t steps) {
+	if (interval == 0 || !sampled)
+		return;
+	elapsed += dt;
+	counter += steps;
+	if (counter < interval)
+		return;
+	counter = 0;
+	sample(s);
+}
+
+void ConservationMonitor::sample(const BodyStore& s) {
+	PhaseTimer timer(PHASE_MONITOR);
+	latest = measureConserved(s);
+	pointMassesOnly = pointMassesOnly && !beyondPointMasses(s);
+	if (!sampled) {
+		initial = latest;
+		elapsed = 0.0;
+		sampled = true;
+	}
+	time = elapsed;
+
+	double energy = fabs(initial.energy());
+	energyDrift = energy > 0.0 ? fabs(latest.energy() - initial.energy()) / energy : 0.0;
+	momentumDrift = initial.momentumScale > 0.0 ? glm::length(latest.momentum - initial.momentum) / initial.momentumScale : 0.0;
+	angularDrift = initial.angularScale > 0.0 ?
+		glm::length(latest.angularMomentum - initial.angularMomentum) / initial.angularScale : 0.0;
+}
\ No newline at end of file
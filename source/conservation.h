@@ -0,0 +1,46 @@
+#pragma once
+
+#include "bodystore.h"
+
+// above this many bodies the potential energy comes from the octree rather than every pair
+const size_t CONSERVATION_DIRECT_LIMIT = 20000;
+// opening angle of that tree, tighter than the force pass so the measure stays below the drift it shows
+const double CONSERVATION_THETA = 0.3;
+
+// the quantities a closed system keeps, and the scales their drifts are measured against
+struct Conserved {
+	double kinetic = 0.0;			// translational and rotational
+	double potential = 0.0;			// of the point masses
+	glm::dvec3 momentum{ 0.0 };
+	glm::dvec3 angularMomentum{ 0.0 };	// orbital about the origin plus the spin of every body
+	double momentumScale = 0.0;		// sum of |m v|, since the total is often zero
+	double angularScale = 0.0;		// sum of |m r x v| and |spin|, likewise
+
+	double energy() const { return kinetic + potential; }
+};
+
+Conserved measureConserved(const BodyStore& s);
+// whether the J2 field or the 1PN terms act on s, neither of which the measure includes nor the model conserves exactly
+bool beyondPointMasses(const BodyStore& s);
+
+// relative drift of the conserved quantities since the first sample, taken every interval steps
+// the measure costs a force pass or more, so with an interval of 0 the monitor does nothing at all
+class ConservationMonitor {
+public:
+	size_t interval = 0;
+	bool sampled = false;			// whether initial and latest hold anything
+	Conserved initial, latest;
+	double time = 0.0;				// simulated time of the latest sample since the first
+	double energyDrift = 0.0;		// |E - E0| / |E0|
+	double momentumDrift = 0.0;		// |P - P0| / sum |m v| at the start
+	double angularDrift = 0.0;		// |L - L0| / sum |m r x v| + |spin| at the start
+	bool pointMassesOnly = true;	// whether every sample since the first saw the point-mass model alone
+
+	void restart();
+	void begin(const BodyStore& s);
+	void step(const BodyStore& s, double dt, size_t steps = 1);
+	void sample(const BodyStore& s);
+private:
+	size_t counter = 0;
+	double elapsed = 0.0;
+};
\ No newline at end of file
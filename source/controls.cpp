@@ -79,6 +79,7 @@ std::unordered_map<int, std::function<void()>> keyActions = {
 	{keyMap[DECREASE_TIME_STEP], []() { timeStep *= 0.9; }},
 	// camera cycles between modes in order
 	{keyMap[CYCLE_CAMERA_MODE], []() {
+		std::lock_guard<std::mutex> lock(physicsMutex);
 		switch (camera.mode) {
 		case LOCK_PLANET_CAM:
 		case LOCK_BARY_CAM:
@@ -98,6 +99,7 @@ std::unordered_map<int, std::function<void()>> keyActions = {
 		}
 		camera.FOV = defaultFOV;
 		bodies[bodies.size() - 1]->parentIndex = -1;
+		reloadState = true;
 	}},
 	{keyMap[SWAP_CAMERAS], []() { std::swap(camera, pipCam); }},
 	{keyMap[SNAP_TO_TARGET], []() {
@@ -181,6 +183,7 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 
 		// handling for body index selection
 		if (key >= GLFW_KEY_0 && key <= GLFW_KEY_9) {
+			std::lock_guard<std::mutex> lock(physicsMutex);
 			size_t index = key - GLFW_KEY_0;
 			if (index < bodies.size() - 1) {
 				if (camera.mode == LOCK_PLANET_CAM || camera.mode == LOCK_BARY_CAM) {
@@ -208,8 +211,11 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 				camera.eyeIndex--;
 		}
 
-		if (key == GLFW_KEY_Z)
+		if (key == GLFW_KEY_Z) {
+			std::lock_guard<std::mutex> lock(physicsMutex);
 			bodies[bodies.size() - 1]->velocity = glm::dvec3(0.0);
+			reloadState = true;
+		}
 	}
 
 	if (camera.atIndex != -1)
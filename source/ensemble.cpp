@@ -0,0 +1,98 @@
+#include "ensemble.h"
+#include "physics.h"
+#include <fstream>
+
+double ensembleSpread = 1e-3;
+uint32_t ensembleSeed = 1;
+
+// scales the mass of every body and its velocity relative to its parent by independent factors 1 + spread N(0, 1)
+// satellites take on the velocity change of their parent, so a moon stays with its perturbed planet
+void perturb(BodyStore& s, double spread, std::mt19937& rng) {
+	std::normal_distribution<double> noise(0.0, spread);
+	size_t n = s.size();
+
+	std::vector<glm::dvec3> change(n, glm::dvec3(0.0));
+	for (size_t i = 0; i < n; i++) {
+		s.mass[i] *= 1.0 + noise(rng);
+		double factor = noise(rng);
+		size_t parent = s.parent[i];
+		if (parent < n && parent != i)
+			change[i] = (s.velocity(i) - s.velocity(parent)) * factor;
+	}
+
+	for (size_t i = 0; i < n; i++) {
+		glm::dvec3 total = change[i];
+		// the chain of parents is cut after n links in case it loops
+		size_t ancestor = s.parent[i];
+		for (size_t depth = 0; ancestor < n && depth < n; depth++) {
+			total += change[ancestor];
+			ancestor = s.parent[ancestor];
+		}
+		s.vx[i] += total.x;
+		s.vy[i] += total.y;
+		s.vz[i] += total.z;
+	}
+}
+
+// K copies of the scene, member 0 as built and the others perturbed, integrated side by side with one member per thread
+// the force passes inside a member run on its thread alone, since OpenMP leaves nested regions to a single thread
+void ensembleLoop(size_t members, size_t steps, double duration) {
+	if (steps == 0)
+		steps = (size_t)ceil(duration / simulationStep);
+
+	applyThreadSettings();
+	printf("gravity kernel: %s\n", simdLevelName(simdLevel));
+	printf("%zu members of %zu bodies, %zu steps of %.3g s on %d threads\n",
+		members, bodies.size(), steps, simulationStep, omp_get_max_threads());
+
+	BodyStore scene;
+	scene.load(bodies);
+
+	std::vector<Simulation> runs(members);
+	std::vector<double> wallTime(members);
+	pairInteractions = 0;
+
+	Clock::time_point start = Clock::now();
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (int k = 0; k < (int)members; k++) {
+		Clock::time_point begin = Clock::now();
+
+		Simulation& run = runs[k];
+		run.state = scene;
+		if (k > 0) {
+			std::mt19937 rng(ensembleSeed + k);
+			perturb(run.state, ensembleSpread, rng);
+		}
+		run.particles = simulation.particles;
+		run.floatParticles = simulation.floatParticles;
+		run.integrator = integrator;
+		run.mergeCollisions = doCollisions;
+		run.regularize = doRegularization;
+		run.compensated = doCompensatedSums;
+		run.monitor.interval = conservationInterval;
+		run.reset();
+
+		for (size_t step = 0; step < steps; step++)
+			run.step(simulationStep);
+
+		wallTime[k] = std::chrono::duration<double>(Clock::now() - begin).count();
+	}
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	std::ofstream out(ENSEMBLE_OUTPUT);
+	out << "member,body,mass,x,y,z,vx,vy,vz\n" << std::setprecision(17);
+	for (size_t k = 0; k < members; k++) {
+		const BodyStore& s = runs[k].state;
+		for (size_t i = 0; i < s.size(); i++) {
+			out << k << ',' << i << ',' << s.mass[i] << ','
+				<< s.px[i] << ',' << s.py[i] << ',' << s.pz[i] << ','
+				<< s.vx[i] << ',' << s.vy[i] << ',' << s.vz[i] << '\n';
+		}
+		printf("member %zu: %.3g s simulated in %.3f s\n", k, runs[k].elapsedTime, wallTime[k]);
+		printConservation(runs[k].monitor);
+		printForceError(runs[k].multipole);
+	}
+
+	printf("%zu members in %.3f s: %.3g member steps/s, %.3g pair interactions/s, final states in %s\n",
+		members, seconds, members * steps / seconds, pairInteractions.load() / seconds, ENSEMBLE_OUTPUT);
+}
\ No newline at end of file
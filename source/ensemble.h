@@ -0,0 +1,13 @@
+#pragma once
+
+#include <random>
+#include "simulation.h"
+
+// final state of every body of every member, one row each
+const char* const ENSEMBLE_OUTPUT = "ensemble.csv";
+
+extern double ensembleSpread;	// relative standard deviation of the perturbed masses and orbital velocities
+extern uint32_t ensembleSeed;	// member k draws its perturbations from seed + k
+
+void perturb(BodyStore& s, double spread, std::mt19937& rng);
+void ensembleLoop(size_t members, size_t steps, double duration);
\ No newline at end of file
@@ -0,0 +1,375 @@
+#include "fmm.h"
+#include "forcemodel.h"
+
+thread_local FastMultipole* activeMultipole = nullptr;
+// force passes outside of a simulation's step, such as those of the benchmarks, use a solver of their thread
+static thread_local FastMultipole threadSolver;
+
+static double binomial(int n, int k) {
+	double result = 1.0;
+	for (int i = 1; i <= k; i++)
+		result = result * (n - k + i) / i;
+	return result;
+}
+
+// rebuilds the multi-index tables and translation operators for expansions of order p
+void FastMultipole::setOrder(int p) {
+	p = std::max(0, std::min(p, FMM_MAX_ORDER));
+	if (p == order)
+		return;
+	order = p;
+
+	exponents.clear();
+	lookup.assign((p + 1) * (p + 1) * (p + 1), -1);
+	for (int degree = 0; degree <= p; degree++) {
+		for (int x = degree; x >= 0; x--) {
+			for (int y = degree - x; y >= 0; y--) {
+				int z = degree - x - y;
+				lookup[(x * (p + 1) + y) * (p + 1) + z] = (int)exponents.size();
+				exponents.push_back({ (uint8_t)x, (uint8_t)y, (uint8_t)z });
+			}
+		}
+	}
+
+	size_t count = coefficientCount();
+	lower.assign(count, { -1, -1, -1 });
+	lower2.assign(count, { -1, -1, -1 });
+	for (size_t i = 0; i < count; i++) {
+		int k[3] = { exponents[i].x, exponents[i].y, exponents[i].z };
+		for (int axis = 0; axis < 3; axis++) {
+			int m[3] = { k[0], k[1], k[2] };
+			if (--m[axis] >= 0)
+				lower[i][axis] = (int16_t)index(m[0], m[1], m[2]);
+			if (--m[axis] >= 0)
+				lower2[i][axis] = (int16_t)index(m[0], m[1], m[2]);
+		}
+	}
+
+	// M2L: L_n = (-1)^|n| sum_k C(k + n, n) M_k a_(k + n), truncated to |k| + |n| <= p
+	m2lTerms.clear();
+	for (size_t n = 0; n < count; n++) {
+		const Exponent& en = exponents[n];
+		double sign = (en.x + en.y + en.z) % 2 ? -1.0 : 1.0;
+		for (size_t k = 0; k < count; k++) {
+			const Exponent& ek = exponents[k];
+			if (en.x + en.y + en.z + ek.x + ek.y + ek.z > p)
+				continue;
+			double coefficient = sign * binomial(ek.x + en.x, en.x) * binomial(ek.y + en.y, en.y) * binomial(ek.z + en.z, en.z);
+			m2lTerms.push_back({ (uint16_t)n, (uint16_t)k, (uint16_t)index(ek.x + en.x, ek.y + en.y, ek.z + en.z), coefficient });
+		}
+	}
+
+	// M2M and L2L are both binomial shifts between a multi-index n and every j <= n
+	shiftTerms.clear();
+	for (size_t n = 0; n < count; n++) {
+		const Exponent& en = exponents[n];
+		for (size_t j = 0; j < count; j++) {
+			const Exponent& ej = exponents[j];
+			if (ej.x > en.x || ej.y > en.y || ej.z > en.z)
+				continue;
+			double coefficient = binomial(en.x, ej.x) * binomial(en.y, ej.y) * binomial(en.z, ej.z);
+			shiftTerms.push_back({ (uint16_t)n, (uint16_t)j, (uint16_t)index(en.x - ej.x, en.y - ej.y, en.z - ej.z), coefficient });
+		}
+	}
+}
+
+// d^k for every multi-index k
+void FastMultipole::monomials(const glm::dvec3& d, double* out) const {
+	out[0] = 1.0;
+	for (size_t i = 1; i < coefficientCount(); i++) {
+		int axis = exponents[i].x ? 0 : exponents[i].y ? 1 : 2;
+		out[i] = out[lower[i][axis]] * d[axis];
+	}
+}
+
+// Taylor coefficients a_k(r) of 1 / |r - d| in d, by the recurrence of Lindsay and Krasny:
+// |k| |r|^2 a_k = (2|k| - 1) sum_i r_i a_(k - e_i) - (|k| - 1) sum_i a_(k - 2 e_i)
+void FastMultipole::derivatives(const glm::dvec3& r, double* out) const {
+	double r2 = glm::dot(r, r);
+	out[0] = 1.0 / sqrt(r2);
+	for (size_t i = 1; i < coefficientCount(); i++) {
+		int degree = exponents[i].x + exponents[i].y + exponents[i].z;
+		double first = 0.0, second = 0.0;
+		for (int axis = 0; axis < 3; axis++) {
+			if (lower[i][axis] >= 0)
+				first += r[axis] * out[lower[i][axis]];
+			if (lower2[i][axis] >= 0)
+				second += out[lower2[i][axis]];
+		}
+		out[i] = ((2 * degree - 1) * first - (degree - 1) * second) / (degree * r2);
+	}
+}
+
+// dual tree traversal, always splitting the larger of the two cells
+void FastMultipole::interact(uint32_t target, uint32_t source, double theta) {
+	const OctreeNode& a = tree.nodes[target];
+	const OctreeNode& b = tree.nodes[source];
+	if (b.mass == 0.0)
+		return;
+
+	if (radius[target] + radius[source] < theta * glm::length(a.center - b.center)) {
+		m2lList[target].push_back(source);
+		return;
+	}
+	if (a.leaf && b.leaf) {
+		p2pList[target].push_back(source);
+		return;
+	}
+
+	if (b.leaf || (!a.leaf && radius[target] >= radius[source])) {
+		for (uint32_t child : a.children) {
+			if (child != OCTREE_NO_CHILD)
+				interact(child, source, theta);
+		}
+	}
+	else {
+		for (uint32_t child : b.children) {
+			if (child != OCTREE_NO_CHILD)
+				interact(target, child, theta);
+		}
+	}
+}
+
+void FastMultipole::particleToMultipole(const BodyStore& s, uint32_t node) {
+	const OctreeNode& cell = tree.nodes[node];
+	double* m = &multipoles[node * coefficientCount()];
+	double power[FMM_MAX_COEFFICIENTS];
+
+	for (uint32_t k = cell.begin; k < cell.end; k++) {
+		uint32_t body = tree.order[k];
+		monomials(s.position(body) - cell.center, power);
+		for (size_t i = 0; i < coefficientCount(); i++)
+			m[i] += s.mass[body] * power[i];
+	}
+}
+
+void FastMultipole::multipoleToMultipole(uint32_t parent, uint32_t child) {
+	const double* in = &multipoles[child * coefficientCount()];
+	double* out = &multipoles[parent * coefficientCount()];
+	double power[FMM_MAX_COEFFICIENTS];
+	monomials(tree.nodes[child].center - tree.nodes[parent].center, power);
+
+	for (const Term& term : shiftTerms)
+		out[term.a] += term.coefficient * in[term.b] * power[term.c];
+}
+
+void FastMultipole::multipoleToLocal(uint32_t target, uint32_t source) {
+	const double* in = &multipoles[source * coefficientCount()];
+	double* out = &locals[target * coefficientCount()];
+	double a[FMM_MAX_COEFFICIENTS];
+	derivatives(tree.nodes[target].center - tree.nodes[source].center, a);
+
+	for (const Term& term : m2lTerms)
+		out[term.a] += term.coefficient * in[term.b] * a[term.c];
+}
+
+void FastMultipole::localToLocal(uint32_t parent, uint32_t child) {
+	const double* in = &locals[parent * coefficientCount()];
+	double* out = &locals[child * coefficientCount()];
+	double power[FMM_MAX_COEFFICIENTS];
+	monomials(tree.nodes[child].center - tree.nodes[parent].center, power);
+
+	for (const Term& term : shiftTerms)
+		out[term.b] += term.coefficient * in[term.a] * power[term.c];
+}
+
+// acceleration is G times the gradient of the local expansion of sum m / r
+void FastMultipole::localToParticles(BodyStore& s, uint32_t leaf) const {
+	const OctreeNode& cell = tree.nodes[leaf];
+	const double* l = &locals[leaf * coefficientCount()];
+	double power[FMM_MAX_COEFFICIENTS];
+
+	for (uint32_t k = cell.begin; k < cell.end; k++) {
+		uint32_t body = tree.order[k];
+		monomials(s.position(body) - cell.center, power);
+
+		glm::dvec3 gradient(0.0);
+		for (size_t i = 1; i < coefficientCount(); i++) {
+			int exponent[3] = { exponents[i].x, exponents[i].y, exponents[i].z };
+			for (int axis = 0; axis < 3; axis++) {
+				if (exponent[axis])
+					gradient[axis] += l[i] * exponent[axis] * power[lower[i][axis]];
+			}
+		}
+
+		s.ax[body] += G * gradient.x;
+		s.ay[body] += G * gradient.y;
+		s.az[body] += G * gradient.z;
+	}
+}
+
+void FastMultipole::particleToParticles(BodyStore& s, uint32_t target, uint32_t source) const {
+	const OctreeNode& a = tree.nodes[target];
+	const OctreeNode& b = tree.nodes[source];
+
+	for (uint32_t i = a.begin; i < a.end; i++) {
+		uint32_t body = tree.order[i];
+		double x = s.px[body], y = s.py[body], z = s.pz[body];
+		double ax = 0.0, ay = 0.0, az = 0.0;
+
+		for (uint32_t j = b.begin; j < b.end; j++) {
+			uint32_t other = tree.order[j];
+			if (other == body)
+				continue;
+			double dx = s.px[other] - x;
+			double dy = s.py[other] - y;
+			double dz = s.pz[other] - z;
+			double r2 = dx * dx + dy * dy + dz * dz;
+			double field = s.mass[other] / (r2 * sqrt(r2));
+			ax += field * dx;
+			ay += field * dy;
+			az += field * dz;
+		}
+
+		s.ax[body] += G * ax;
+		s.ay[body] += G * ay;
+		s.az[body] += G * az;
+	}
+}
+
+// adds point-mass accelerations to the store
+void FastMultipole::evaluate(BodyStore& s, double theta) {
+	tree.leafSize = FMM_LEAF_SIZE;
+	tree.build(s, theta);
+	passes++;
+	if (tree.nodes.empty())
+		return;
+
+	size_t nodeCount = tree.nodes.size();
+	size_t count = coefficientCount();
+
+	// nodes are stored in depth-first order, so parents always precede their children
+	std::vector<uint8_t> depth(nodeCount, 0);
+	for (auto& level : levels)
+		level.clear();
+	leaves.clear();
+	for (uint32_t i = 0; i < nodeCount; i++) {
+		if (levels.size() <= depth[i])
+			levels.resize(depth[i] + 1);
+		levels[depth[i]].push_back(i);
+		if (tree.nodes[i].leaf)
+			leaves.push_back(i);
+		for (uint32_t child : tree.nodes[i].children) {
+			if (child != OCTREE_NO_CHILD)
+				depth[child] = depth[i] + 1;
+		}
+	}
+
+	radius.assign(nodeCount, 0.0);
+	multipoles.assign(nodeCount * count, 0.0);
+	locals.assign(nodeCount * count, 0.0);
+
+	// upward pass
+	for (int level = (int)levels.size() - 1; level >= 0; level--) {
+		const std::vector<uint32_t>& nodes = levels[level];
+		#pragma omp parallel for schedule(dynamic, 16)
+		for (int i = 0; i < (int)nodes.size(); i++) {
+			uint32_t node = nodes[i];
+			const OctreeNode& cell = tree.nodes[node];
+			if (cell.leaf) {
+				for (uint32_t k = cell.begin; k < cell.end; k++)
+					radius[node] = std::max(radius[node], glm::length(s.position(tree.order[k]) - cell.center));
+				particleToMultipole(s, node);
+				continue;
+			}
+			for (uint32_t child : cell.children) {
+				if (child == OCTREE_NO_CHILD)
+					continue;
+				radius[node] = std::max(radius[node], radius[child] + glm::length(tree.nodes[child].center - cell.center));
+				multipoleToMultipole(node, child);
+			}
+		}
+	}
+
+	m2lList.resize(nodeCount);
+	p2pList.resize(nodeCount);
+	for (size_t i = 0; i < nodeCount; i++) {
+		m2lList[i].clear();
+		p2pList[i].clear();
+	}
+	interact(0, 0, theta);
+
+	#pragma omp parallel for schedule(dynamic, 16)
+	for (int target = 0; target < (int)nodeCount; target++) {
+		for (uint32_t source : m2lList[target])
+			multipoleToLocal(target, source);
+	}
+
+	// downward pass
+	for (size_t level = 0; level + 1 < levels.size(); level++) {
+		const std::vector<uint32_t>& nodes = levels[level];
+		#pragma omp parallel for schedule(dynamic, 16)
+		for (int i = 0; i < (int)nodes.size(); i++) {
+			for (uint32_t child : tree.nodes[nodes[i]].children) {
+				if (child != OCTREE_NO_CHILD)
+					localToLocal(nodes[i], child);
+			}
+		}
+	}
+
+	#pragma omp parallel for schedule(dynamic, 4)
+	for (int i = 0; i < (int)leaves.size(); i++) {
+		localToParticles(s, leaves[i]);
+		for (uint32_t source : p2pList[leaves[i]])
+			particleToParticles(s, leaves[i], source);
+	}
+}
+
+bool FastMultipole::errorIsStale(size_t n, double theta) const {
+	return passes % FMM_ERROR_INTERVAL == 1 || order != sampledOrder || theta != sampledTheta || n != sampledCount;
+}
+
+// compares the accelerations of a spread of bodies against direct summation
+void FastMultipole::sampleError(const BodyStore& s, double theta) {
+	size_t n = s.size();
+	size_t samples = std::min(n, FMM_ERROR_SAMPLES);
+	std::vector<double> error(samples, 0.0);
+
+	#pragma omp parallel for
+	for (int t = 0; t < (int)samples; t++) {
+		size_t body = t * n / samples;
+		glm::dvec3 exact(0.0);
+		for (size_t other = 0; other < n; other++) {
+			if (other == body)
+				continue;
+			glm::dvec3 displacement = s.position(other) - s.position(body);
+			double distance = glm::length(displacement);
+			exact += displacement * (G * s.mass[other] / (distance * distance * distance));
+		}
+		double magnitude = glm::length(exact);
+		error[t] = magnitude > 0.0 ? glm::length(s.acceleration(body) - exact) / magnitude : 0.0;
+	}
+
+	double sum = 0.0, worst = 0.0;
+	for (double e : error) {
+		sum += e * e;
+		worst = std::max(worst, e);
+	}
+	errorRms = samples ? sqrt(sum / samples) : 0.0;
+	errorMax = worst;
+	errorSamples++;
+
+	sampledOrder = order;
+	sampledTheta = theta;
+	sampledCount = n;
+}
+
+// FMM force pass: point masses through the expansions, oblate terms summed exactly on top
+void multipoleForces(BodyStore& s, double theta, int order) {
+	FastMultipole& solver = activeMultipole ? *activeMultipole : threadSolver;
+	solver.setOrder(order);
+	solver.evaluate(s, theta);
+	if (solver.errorIsStale(s.size(), theta))
+		solver.sampleError(s, theta);
+
+	std::vector<size_t> oblate = oblateBodies(s);
+	ForceTarget out(s);
+	withForceModel(s, false, false, [&](auto model) {
+		using Model = decltype(model);
+		if constexpr (!Model::empty) {
+			#pragma omp parallel for schedule(dynamic, 64)
+			for (int i = 0; i < (int)s.size(); i++)
+				Model::gather(s, i, oblate, out);
+		}
+	});
+}
\ No newline at end of file
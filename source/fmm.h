@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include "octree.h"
+
+const int FMM_MAX_ORDER = 12;
+// expansion coefficients of the highest order, (p + 1)(p + 2)(p + 3) / 6
+const size_t FMM_MAX_COEFFICIENTS = 455;
+// leaves are larger than for Barnes-Hut, where the direct sum between two leaves is cheaper than the translations
+const size_t FMM_LEAF_SIZE = 32;
+// the force error is resampled after this many passes, and whenever the order or opening angle changes
+const int FMM_ERROR_INTERVAL = 1000;
+const size_t FMM_ERROR_SAMPLES = 256;
+
+// fast multipole solver using Cartesian Taylor expansions of order p over an octree
+// a dual tree traversal pairs the cells: well separated pairs translate the source multipole into a local
+// expansion of the target (M2L), while pairs of leaves that are too close are summed directly
+class FastMultipole {
+public:
+	void setOrder(int p);
+	void evaluate(BodyStore& s, double theta);
+	void sampleError(const BodyStore& s, double theta);
+	bool errorIsStale(size_t n, double theta) const;
+
+	// relative point-mass force error against direct summation over the last sampled subset of bodies
+	std::atomic<double> errorRms = 0.0, errorMax = 0.0;
+	std::atomic<size_t> errorSamples = 0;	// error samples taken, so a report can tell a fresh one
+private:
+	struct Exponent {
+		uint8_t x, y, z;
+	};
+
+	// one product of a translation: out[a] += coefficient * in[b] * factor[c]
+	struct Term {
+		uint16_t a, b, c;
+		double coefficient;
+	};
+
+	int order = -1;
+	std::vector<Exponent> exponents;			// multi-indices ordered by degree
+	std::vector<int> lookup;
+	std::vector<std::array<int16_t, 3>> lower;	// index of k - e_i, or -1
+	std::vector<std::array<int16_t, 3>> lower2;	// index of k - 2 e_i, or -1
+	std::vector<Term> m2lTerms, shiftTerms;
+
+	Octree tree;
+	std::vector<double> radius;					// distance from the cell center to its furthest body
+	std::vector<std::vector<uint32_t>> levels;
+	std::vector<uint32_t> leaves;
+	std::vector<std::vector<uint32_t>> m2lList, p2pList;
+	std::vector<double> multipoles, locals;
+
+	int passes = 0;
+	int sampledOrder = -1;
+	double sampledTheta = 0.0;
+	size_t sampledCount = 0;
+
+	size_t coefficientCount() const { return exponents.size(); }
+	int index(int x, int y, int z) const { return lookup[(x * (order + 1) + y) * (order + 1) + z]; }
+
+	void monomials(const glm::dvec3& d, double* out) const;
+	void derivatives(const glm::dvec3& r, double* out) const;
+	void interact(uint32_t target, uint32_t source, double theta);
+
+	void particleToMultipole(const BodyStore& s, uint32_t node);
+	void multipoleToMultipole(uint32_t parent, uint32_t child);
+	void multipoleToLocal(uint32_t target, uint32_t source);
+	void localToLocal(uint32_t parent, uint32_t child);
+	void localToParticles(BodyStore& s, uint32_t leaf) const;
+	void particleToParticles(BodyStore& s, uint32_t target, uint32_t source) const;
+};
+
+// solver of the simulation stepping on this thread, set for the length of its step like activeProfiler
+extern thread_local FastMultipole* activeMultipole;
+
+void multipoleForces(BodyStore& s, double theta, int order);
\ No newline at end of file
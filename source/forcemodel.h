@@ -0,0 +1,139 @@
+#pragma once
+
+#include <type_traits>
+#include "forces.h"
+
+// separation of one (target, source) pair, shared by the terms of a model
+struct PairGeometry {
+	glm::dvec3 displacement;	// from the target to the source
+	double distance;
+
+	PairGeometry(const BodyStore& s, size_t target, size_t source) :
+		displacement(s.position(source) - s.position(target)), distance(glm::length(displacement)) {
+	}
+};
+
+// every term adds what source does to target in apply, and what every source does to target in gather;
+// both only write the target's accumulators, so targets can be split between threads
+
+// Newtonian attraction of point masses
+struct PointMass {
+	static void apply(const BodyStore& s, size_t target, size_t source, const PairGeometry& pair, ForceTarget out) {
+		out.addAcceleration(target, pair.displacement * (G * s.mass[source] / (pair.distance * pair.distance * pair.distance)));
+	}
+
+	static void gather(const BodyStore& s, size_t target, const std::vector<size_t>& /*oblate*/, ForceTarget out) {
+		out.addAcceleration(target, pointField(s, s.position(target)));
+	}
+};
+
+// J2 field of an oblate source
+struct OblateField {
+	static void apply(const BodyStore& s, size_t target, size_t source, const PairGeometry& /*pair*/, ForceTarget out) {
+		if (s.gravityType[source] == OBLATE_SPHERE)
+			out.addAcceleration(target, oblateAcceleration(s, source, s.position(target)));
+	}
+
+	static void gather(const BodyStore& s, size_t target, const std::vector<size_t>& oblate, ForceTarget out) {
+		for (size_t body : oblate) {
+			if (body != target)
+				out.addAcceleration(target, oblateAcceleration(s, body, s.position(target)));
+		}
+	}
+};
+
+// torque of a point-mass source on the bulge of an oblate target
+struct OblateTorque {
+	static void apply(const BodyStore& s, size_t target, size_t source, const PairGeometry& /*pair*/, ForceTarget out) {
+		if (s.gravityType[target] == OBLATE_SPHERE)
+			out.addTorque(target, oblateTorque(s, target, s.position(source), s.mass[source]));
+	}
+
+	static void gather(const BodyStore& s, size_t target, const std::vector<size_t>& /*oblate*/, ForceTarget out) {
+		if (s.gravityType[target] != OBLATE_SPHERE)
+			return;
+		for (size_t other = 0; other < s.size(); other++) {
+			if (other != target)
+				out.addTorque(target, oblateTorque(s, target, s.position(other), s.mass[other]));
+		}
+	}
+};
+
+// first post-Newtonian acceleration of each pair as a binary in harmonic coordinates, shared between the two
+// in proportion to the other's mass; the three-body terms of the full Einstein-Infeld-Hoffmann equations are
+// left out, which for planets about a dominant star still gives the relativistic perihelion advance
+struct PostNewtonian {
+	static void apply(const BodyStore& s, size_t target, size_t source, const PairGeometry& pair, ForceTarget out) {
+		double total = s.mass[target] + s.mass[source];
+		double nu = s.mass[target] / total * (s.mass[source] / total);
+		double gm = G * total;
+
+		glm::dvec3 direction = -pair.displacement / pair.distance;
+		glm::dvec3 velocity = s.velocity(target) - s.velocity(source);
+		double radialSpeed = glm::dot(direction, velocity);
+		double speed2 = glm::dot(velocity, velocity);
+
+		glm::dvec3 relative = gm / (SPEED_OF_LIGHT * SPEED_OF_LIGHT * pair.distance * pair.distance) *
+			((2.0 * (2.0 + nu) * gm / pair.distance - (1.0 + 3.0 * nu) * speed2 + 1.5 * nu * radialSpeed * radialSpeed) * direction +
+			2.0 * (2.0 - nu) * radialSpeed * velocity);
+		out.addAcceleration(target, relative * (s.mass[source] / total));
+	}
+
+	static void gather(const BodyStore& s, size_t target, const std::vector<size_t>& /*oblate*/, ForceTarget out) {
+		for (size_t source = 0; source < s.size(); source++) {
+			if (source != target)
+				apply(s, target, source, PairGeometry(s, target, source), out);
+		}
+	}
+};
+
+// a set of terms composed at compile time, so a pair loop instantiated for a model carries no test for terms it leaves out
+template <class... Terms>
+struct ForceModel {
+	template <class Term>
+	using with = ForceModel<Terms..., Term>;
+
+	template <class Term>
+	static constexpr bool has = (std::is_same_v<Term, Terms> || ...);
+
+	static constexpr bool empty = sizeof...(Terms) == 0;
+
+	// the empty model leaves its arguments unread
+	static void pull(const BodyStore& s, size_t target, size_t source, [[maybe_unused]] ForceTarget out) {
+		PairGeometry pair(s, target, source);
+		(Terms::apply(s, target, source, pair, out), ...);
+	}
+
+	static void force(BodyStore& s, size_t a, size_t b) {
+		pull(s, a, b, s);
+		pull(s, b, a, s);
+	}
+
+	static void gather(const BodyStore& s, [[maybe_unused]] size_t target, const std::vector<size_t>& oblate,
+		[[maybe_unused]] ForceTarget out) {
+		(Terms::gather(s, target, oblate, out), ...);
+	}
+};
+
+// appends each term whose flag is set and hands the finished model to visit as a value of its type
+template <class Model, class Visitor>
+void composeModel(Visitor&& visit) {
+	visit(Model());
+}
+
+template <class Model, class Term, class... Rest, class Visitor, class... Flags>
+void composeModel(Visitor&& visit, bool enabled, Flags... flags) {
+	if (enabled)
+		composeModel<typename Model::template with<Term>, Rest...>(visit, flags...);
+	else
+		composeModel<Model, Rest...>(visit, flags...);
+}
+
+// model of the current settings for a pass over s, chosen once per pass: without point masses for passes whose
+// kernels or expansions already cover them, and without relativity for the approximate engines
+template <class Visitor>
+void withForceModel(const BodyStore& s, bool pointMasses, bool relativity, Visitor&& visit) {
+	bool oblate = std::find(s.gravityType.begin(), s.gravityType.end(), OBLATE_SPHERE) != s.gravityType.end();
+	composeModel<ForceModel<>, PointMass, OblateField, OblateTorque, PostNewtonian>(visit,
+		pointMasses, oblate && oblateGravity, oblate && oblateTorques, relativity && postNewtonian);
+}
\ No newline at end of file
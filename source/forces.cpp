@@ -0,0 +1,221 @@
+#include "forcemodel.h"
+#include "octree.h"
+#include "fmm.h"
+#include "particlemesh.h"
+#include "profiler.h"
+
+const char* const engineNames[ENGINE_COUNT] = { "direct", "barnes-hut", "fmm", "mesh" };
+
+force_engine forceEngine = DIRECT;
+double openingAngle = 0.5;
+int multipoleOrder = 4;
+bool oblateGravity = true;
+bool oblateTorques = true;
+bool postNewtonian = false;
+std::atomic<uint64_t> pairInteractions(0);
+
+// per-thread accumulators of the parallel force pass, reduced into the store once every tile is done
+struct ForceBuffer {
+	std::vector<double> ax, ay, az, tx, ty, tz, jx, jy, jz;
+
+	void clear(size_t n, bool withJerk) {
+		for (std::vector<double>* field : { &ax, &ay, &az, &tx, &ty, &tz })
+			field->assign(n, 0.0);
+		if (withJerk) {
+			for (std::vector<double>* field : { &jx, &jy, &jz })
+				field->assign(n, 0.0);
+		}
+	}
+
+	ForceTarget target() {
+		return ForceTarget(ax.data(), ay.data(), az.data(), tx.data(), ty.data(), tz.data());
+	}
+
+	ForceOutput output() {
+		return ForceOutput{ ax.data(), ay.data(), az.data(), jx.data(), jy.data(), jz.data() };
+	}
+};
+
+// per simulation thread, so simulations stepping side by side never reduce into each other's buffers
+static thread_local std::vector<ForceBuffer> threadBuffers;
+
+// oblate perturbation felt at target by body, using MacCullagh's formula
+glm::dvec3 oblateAcceleration(const BodyStore& s, size_t body, const glm::dvec3& target) {
+	glm::dvec3 displacement = s.position(body) - target;
+	double distance = glm::length(displacement);
+	glm::dvec3 direction = displacement / distance;
+	glm::dvec3 fieldLine = (G * direction) / (distance * distance);
+
+	double cosTheta = glm::dot(-direction, s.axis(body));
+	double sin2Theta = 1 - cosTheta * cosTheta;
+	double radiusOverDistance = s.radius[body] / distance;
+
+	return -s.mass[body] * fieldLine *
+		3.0 * s.j2[body] * radiusOverDistance * radiusOverDistance * (3.0 * sin2Theta - 1.0);
+}
+
+// torque on an oblate body from a point mass at source
+glm::dvec3 oblateTorque(const BodyStore& s, size_t body, const glm::dvec3& source, double sourceMass) {
+	glm::dvec3 displacement = source - s.position(body);
+	double distance = glm::length(displacement);
+	glm::dvec3 direction = displacement / distance;
+
+	glm::dvec3 axisOfRotation = s.axis(body);
+	double cosTheta = glm::dot(direction, axisOfRotation);
+	double radiusOverDistance = s.radius[body] / distance;
+
+	return 3.0 * G * sourceMass * s.mass[body] * s.j2[body] * radiusOverDistance * radiusOverDistance / distance
+		* cosTheta * glm::cross(direction, axisOfRotation);
+}
+
+std::vector<size_t> oblateBodies(const BodyStore& s) {
+	std::vector<size_t> oblate;
+	for (size_t i = 0; i < s.size(); i++) {
+		if (s.gravityType[i] == OBLATE_SPHERE)
+			oblate.push_back(i);
+	}
+	return oblate;
+}
+
+// adds the accelerations and torques of every pair to the store, and with withJerk the point-mass jerks
+void directForces(BodyStore& s, bool withJerk) {
+	PhaseTimer timer(PHASE_FORCES);
+	size_t n = s.size();
+	pairInteractions += n * (n - 1) / 2;
+
+	if (simdLevel == SIMD_SCALAR && !withJerk) {
+		// reference path: every pair through the exact scalar routine
+		withForceModel(s, true, true, [&](auto model) {
+			using Model = decltype(model);
+			for (size_t i = 0; i < n; ++i) {
+				for (size_t j = i + 1; j < n; ++j)
+					Model::force(s, i, j);
+			}
+		});
+		return;
+	}
+
+	// upper triangle of tile pairs, each evaluated symmetrically by one thread
+	std::vector<std::pair<size_t, size_t>> tiles;
+	size_t tileCount = (n + FORCE_TILE_SIZE - 1) / FORCE_TILE_SIZE;
+	for (size_t i = 0; i < tileCount; i++) {
+		for (size_t j = i; j < tileCount; j++)
+			tiles.emplace_back(i, j);
+	}
+
+	std::vector<size_t> oblate = oblateBodies(s);
+
+	std::vector<ForceBuffer>& forceBuffers = threadBuffers;
+	if (forceBuffers.size() < (size_t)omp_get_max_threads())
+		forceBuffers.resize(omp_get_max_threads());
+	int threadCount = 1;
+
+	#pragma omp parallel
+	{
+		#pragma omp single
+		threadCount = omp_get_num_threads();
+
+		ForceBuffer& buffer = forceBuffers[omp_get_thread_num()];
+		buffer.clear(n, withJerk);
+
+		#pragma omp for schedule(dynamic)
+		for (int t = 0; t < (int)tiles.size(); t++) {
+			size_t iBegin = tiles[t].first * FORCE_TILE_SIZE;
+			size_t jBegin = tiles[t].second * FORCE_TILE_SIZE;
+			size_t iEnd = std::min(n, iBegin + FORCE_TILE_SIZE);
+			size_t jEnd = std::min(n, jBegin + FORCE_TILE_SIZE);
+			if (withJerk)
+				pointJerk(s, buffer.output(), iBegin, iEnd, jBegin, jEnd);
+			else
+				pointGravity(s, buffer.ax.data(), buffer.ay.data(), buffer.az.data(), iBegin, iEnd, jBegin, jEnd);
+		}
+
+		// the terms beyond point masses, gathered by each target into the thread's buffer
+		ForceTarget out = buffer.target();
+		withForceModel(s, false, true, [&](auto model) {
+			using Model = decltype(model);
+			if constexpr (!Model::empty) {
+				#pragma omp for schedule(dynamic, 64)
+				for (int i = 0; i < (int)n; i++)
+					Model::gather(s, i, oblate, out);
+			}
+		});
+
+		#pragma omp for schedule(static)
+		for (int i = 0; i < (int)n; i++) {
+			for (int t = 0; t < threadCount; t++) {
+				const ForceBuffer& partial = forceBuffers[t];
+				s.ax[i] += partial.ax[i];
+				s.ay[i] += partial.ay[i];
+				s.az[i] += partial.az[i];
+				s.tx[i] += partial.tx[i];
+				s.ty[i] += partial.ty[i];
+				s.tz[i] += partial.tz[i];
+				if (withJerk) {
+					s.jx[i] += partial.jx[i];
+					s.jy[i] += partial.jy[i];
+					s.jz[i] += partial.jz[i];
+				}
+			}
+		}
+	}
+}
+
+// adds the accelerations and torques of the selected force engine to the store
+void computeForces(BodyStore& s) {
+	PhaseTimer timer(PHASE_FORCES);
+	// the direct pass counts itself, the approximate engines count what they stand in for
+	if (forceEngine != DIRECT)
+		pairInteractions += s.size() * (s.size() - 1) / 2;
+
+	switch (forceEngine) {
+	case BARNES_HUT:
+		treeForces(s, openingAngle);
+		break;
+	case FMM:
+		multipoleForces(s, openingAngle, multipoleOrder);
+		break;
+	case PARTICLE_MESH:
+		meshForces(s, meshSize, meshAssignment, shortRangeCorrection);
+		break;
+	default:
+		directForces(s);
+		break;
+	}
+}
+
+// accelerations and torques of a subset of bodies at the positions currently in the store
+// bodies outside the subset keep their accumulators unless the engine has no cheaper pass than a full one
+void computeForces(BodyStore& s, const std::vector<uint32_t>& active) {
+	PhaseTimer timer(PHASE_FORCES);
+	size_t n = s.size();
+	bool subset = forceEngine == BARNES_HUT || (forceEngine == DIRECT && active.size() * 2 < n);
+	if (!subset) {
+		s.clearForces();
+		computeForces(s);
+		return;
+	}
+
+	// unordered pairs with an active body, as counted by the full pass; those between two active bodies are met twice
+	size_t a = active.size();
+	pairInteractions += a * (n - 1) - a * (a - 1) / 2;
+	for (uint32_t i : active) {
+		s.ax[i] = s.ay[i] = s.az[i] = 0.0;
+		s.tx[i] = s.ty[i] = s.tz[i] = 0.0;
+	}
+
+	if (forceEngine == BARNES_HUT) {
+		treeForces(s, openingAngle, active);
+		return;
+	}
+
+	// one-sided direct sum, cheaper than the symmetric pass while few bodies are active
+	std::vector<size_t> oblate = oblateBodies(s);
+	ForceTarget out(s);
+	withForceModel(s, true, true, [&](auto model) {
+		using Model = decltype(model);
+		#pragma omp parallel for schedule(dynamic, 4)
+		for (int k = 0; k < (int)active.size(); k++)
+			Model::gather(s, active[k], oblate, out);
+	});
+}
\ No newline at end of file
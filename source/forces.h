@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include "gravitykernel.h"
+
+enum force_engine : uint8_t {
+	DIRECT,
+	BARNES_HUT,
+	FMM,
+	PARTICLE_MESH,
+	ENGINE_COUNT
+};
+
+extern const char* const engineNames[ENGINE_COUNT];
+
+// bodies per tile of the direct force pass: the positions, masses and accumulators of an i and a j tile
+// (2 * 7 * 256 doubles, 28 kB) stay resident in L1 while the tile pair is evaluated
+const size_t FORCE_TILE_SIZE = 256;
+
+extern force_engine forceEngine;
+extern double openingAngle;
+extern int multipoleOrder;
+extern bool oblateGravity;		// J2 field of oblate bodies
+extern bool oblateTorques;		// torques on the bulges of oblate bodies
+extern bool postNewtonian;		// first post-Newtonian pair terms, summed directly and left out by the approximate engines
+extern std::atomic<uint64_t> pairInteractions;	// pairs a direct sum would have evaluated, counted by every force pass
+
+// destination of accelerations and torques, either the store itself or a per-thread buffer
+struct ForceTarget {
+	double *ax, *ay, *az, *tx, *ty, *tz;
+
+	ForceTarget(BodyStore& s) :
+		ax(s.ax.data()), ay(s.ay.data()), az(s.az.data()), tx(s.tx.data()), ty(s.ty.data()), tz(s.tz.data()) {
+	}
+
+	ForceTarget(double* ax, double* ay, double* az, double* tx, double* ty, double* tz) :
+		ax(ax), ay(ay), az(az), tx(tx), ty(ty), tz(tz) {
+	}
+
+	void addAcceleration(size_t i, const glm::dvec3& acceleration) {
+		ax[i] += acceleration.x;
+		ay[i] += acceleration.y;
+		az[i] += acceleration.z;
+	}
+
+	void addTorque(size_t i, const glm::dvec3& torque) {
+		tx[i] += torque.x;
+		ty[i] += torque.y;
+		tz[i] += torque.z;
+	}
+};
+
+glm::dvec3 oblateAcceleration(const BodyStore& s, size_t body, const glm::dvec3& target);
+glm::dvec3 oblateTorque(const BodyStore& s, size_t body, const glm::dvec3& source, double sourceMass);
+std::vector<size_t> oblateBodies(const BodyStore& s);
+void directForces(BodyStore& s, bool withJerk = false);
+void computeForces(BodyStore& s);
+void computeForces(BodyStore& s, const std::vector<uint32_t>& active);
\ No newline at end of file
@@ -0,0 +1,319 @@
+#include "gaussradau.h"
+#include "rotation.h"
+
+double radauTolerance = 1e-9;
+
+// fractions of the step at which forces are evaluated: its start and the roots of P7 + P8 mapped onto [0, 1]
+static const double nodes[RADAU_NODES] = {
+	0.0,
+	0.0562625605369221464656522,
+	0.1802406917368923649875799,
+	0.3526247171131696373739078,
+	0.5471536263305553830014486,
+	0.7342101772154105315232106,
+	0.8853209468390957680903598,
+	0.9775206135612875018911745
+};
+
+// newton[j][k] is the coefficient of t^(k + 1) in t (t - h1) ... (t - hj), turning the divided differences g of the
+// acceleration at the nodes into the coefficients b of its power series in t
+struct RadauTables {
+	double newton[RADAU_NODES - 1][RADAU_NODES - 1] = {};
+	double binomial[RADAU_NODES][RADAU_NODES] = {};
+
+	RadauTables() {
+		newton[0][0] = 1.0;
+		for (int j = 1; j < RADAU_NODES - 1; j++) {
+			for (int k = 0; k <= j; k++)
+				newton[j][k] = (k > 0 ? newton[j - 1][k - 1] : 0.0) - nodes[j] * (k < j ? newton[j - 1][k] : 0.0);
+		}
+		for (int j = 0; j < RADAU_NODES; j++) {
+			binomial[j][0] = 1.0;
+			for (int k = 1; k <= j; k++)
+				binomial[j][k] = binomial[j - 1][k - 1] + (k < j ? binomial[j - 1][k] : 0.0);
+		}
+	}
+};
+
+static const RadauTables tables;
+
+// Kahan summation, so that the many small increments of a long run don't lose the low bits of the state
+static inline void compensatedAdd(double& value, double& compensation, double increment) {
+	double y = increment - compensation;
+	double t = value + y;
+	compensation = (t - value) - y;
+	value = t;
+}
+
+void GaussRadau::initialize(BodyStore& s) {
+	count = 3 * s.size();
+	for (std::vector<double>* field : { &x0, &v0, &a0 })
+		field->resize(count);
+	for (std::vector<double>* field : { &compensatedX, &compensatedV })
+		field->assign(count, 0.0);
+	for (int k = 0; k < RADAU_NODES - 1; k++) {
+		b[k].resize(count);
+		g[k].resize(count);
+	}
+	clearSeries();
+
+	for (size_t i = 0; i < s.size(); i++) {
+		glm::dvec3 position = s.position(i), velocity = s.velocity(i);
+		for (int axis = 0; axis < 3; axis++) {
+			x0[3 * i + axis] = position[axis];
+			v0[3 * i + axis] = velocity[axis];
+		}
+	}
+
+	dt = 0.0;
+	lastStep = 0.0;
+	pendingKick = 0.0;
+	initialized = true;
+}
+
+void GaussRadau::clearSeries() {
+	for (int k = 0; k < RADAU_NODES - 1; k++) {
+		std::fill(b[k].begin(), b[k].end(), 0.0);
+		std::fill(g[k].begin(), g[k].end(), 0.0);
+	}
+}
+
+// positions and velocities a fraction t into a step of length h, integrating the acceleration series
+void GaussRadau::predict(BodyStore& s, double h, double t) {
+	double positionTerms[RADAU_NODES - 1], velocityTerms[RADAU_NODES - 1];
+	double power = t * t;
+	for (int k = 0; k < RADAU_NODES - 1; k++) {
+		velocityTerms[k] = h * power / (k + 2);
+		power *= t;
+		positionTerms[k] = h * h * power / ((k + 2) * (k + 3));
+	}
+
+	double* position[3] = { s.px.data(), s.py.data(), s.pz.data() };
+	double* velocity[3] = { s.vx.data(), s.vy.data(), s.vz.data() };
+	int n = (int)s.size();
+
+	#pragma omp parallel for
+	for (int i = 0; i < n; i++) {
+		for (int axis = 0; axis < 3; axis++) {
+			size_t c = 3 * i + axis;
+			double x = x0[c] + v0[c] * t * h + a0[c] * 0.5 * t * t * h * h;
+			double v = v0[c] + a0[c] * t * h;
+			for (int k = 0; k < RADAU_NODES - 1; k++) {
+				x += b[k][c] * positionTerms[k];
+				v += b[k][c] * velocityTerms[k];
+			}
+			position[axis][i] = x;
+			velocity[axis][i] = v;
+		}
+	}
+}
+
+// the acceleration needs no smoothing of the tree or mesh engines, so forces are summed directly
+void GaussRadau::evaluate(BodyStore& s) {
+	s.clearForces();
+	directForces(s);
+}
+
+// series of the previous step re-expanded about its end and rescaled to a step q times as long,
+// the starting guess of the predictor-corrector
+void GaussRadau::extrapolate(double q) {
+	#pragma omp parallel for
+	for (int c = 0; c < (int)count; c++) {
+		double shifted[RADAU_NODES - 1];
+		double scale = q;
+		for (int k = 1; k < RADAU_NODES; k++) {
+			double sum = 0.0;
+			for (int j = k; j < RADAU_NODES; j++)
+				sum += tables.binomial[j][k] * b[j - 1][c];
+			shifted[k - 1] = sum * scale;
+			scale *= q;
+		}
+
+		// divided differences matching the new series, solved from the highest term down
+		for (int k = RADAU_NODES - 2; k >= 0; k--) {
+			b[k][c] = shifted[k];
+			double value = shifted[k];
+			for (int j = k + 1; j < RADAU_NODES - 1; j++)
+				value -= tables.newton[j][k] * g[j][c];
+			g[k][c] = value;
+		}
+	}
+}
+
+// one step of length h from the state in x0, v0 and a0, accepted unless the error estimate
+// asks for a much shorter one; proposed is the step the estimate allows
+bool GaussRadau::attempt(BodyStore& s, double h, double& proposed) {
+	const double* acceleration[3] = { s.ax.data(), s.ay.data(), s.az.data() };
+	int n = (int)s.size();
+	std::vector<double> change(count);
+	double previousError = 0.0;
+
+	for (int iteration = 0; iteration < RADAU_MAX_ITERATIONS; iteration++) {
+		for (int node = 1; node < RADAU_NODES; node++) {
+			predict(s, h, nodes[node]);
+			evaluate(s);
+
+			#pragma omp parallel for
+			for (int i = 0; i < n; i++) {
+				for (int axis = 0; axis < 3; axis++) {
+					size_t c = 3 * i + axis;
+					double value = (acceleration[axis][i] - a0[c]) / nodes[node];
+					for (int m = 1; m < node; m++)
+						value = (value - g[m - 1][c]) / (nodes[node] - nodes[m]);
+					double delta = value - g[node - 1][c];
+					g[node - 1][c] = value;
+					for (int k = 0; k < node; k++)
+						b[k][c] += delta * tables.newton[node - 1][k];
+					change[c] = delta;
+				}
+			}
+		}
+
+		// converged once the last term stops changing at the level of round-off
+		double maxChange = 0.0, maxAcceleration = 0.0;
+		for (int i = 0; i < n; i++) {
+			for (int axis = 0; axis < 3; axis++) {
+				maxChange = std::max(maxChange, fabs(change[3 * i + axis]));
+				maxAcceleration = std::max(maxAcceleration, fabs(acceleration[axis][i]));
+			}
+		}
+		double error = maxAcceleration > 0.0 ? maxChange / maxAcceleration : 0.0;
+		if (error < 1e-16 || (iteration > 1 && error >= previousError))
+			break;
+		previousError = error;
+	}
+
+	// the last term of the series against the acceleration estimates the truncation error, shown in the interface
+	double maxTerm = 0.0, maxAcceleration = 0.0;
+	for (int i = 0; i < n; i++) {
+		for (int axis = 0; axis < 3; axis++) {
+			maxTerm = std::max(maxTerm, fabs(b[RADAU_NODES - 2][3 * i + axis]));
+			maxAcceleration = std::max(maxAcceleration, fabs(acceleration[axis][i]));
+		}
+	}
+	double error = maxAcceleration > 0.0 ? maxTerm / maxAcceleration : 0.0;
+
+	// the step itself follows the shortest timescale of acceleration, jerk and snap at the end of the step
+	// (Pham, Rein & Spiegel 2024), which unlike the last term stays clear of round-off in the forces on
+	// satellites far from the origin, where it would otherwise shrink the step without end
+	double shortest = std::numeric_limits<double>::infinity();
+	for (int i = 0; i < n; i++) {
+		glm::dvec3 end(0.0), jerk(0.0), snap(0.0);
+		for (int axis = 0; axis < 3; axis++) {
+			size_t c = 3 * i + axis;
+			end[axis] = a0[c];
+			for (int k = 0; k < RADAU_NODES - 1; k++) {
+				end[axis] += b[k][c];
+				jerk[axis] += (k + 1) * b[k][c];
+				snap[axis] += (k + 1) * k * b[k][c];
+			}
+		}
+		double y2 = glm::dot(end, end), y3 = glm::dot(jerk, jerk), y4 = glm::dot(snap, snap);
+		double timescale2 = 2.0 * y2 / (y3 + sqrt(y4 * y2));
+		if (std::isnormal(y2) && std::isnormal(timescale2))
+			shortest = std::min(shortest, timescale2);
+	}
+	proposed = std::isfinite(shortest)
+		? sqrt(shortest) * h * pow(radauTolerance * 5040.0, 1.0 / (RADAU_NODES - 1))
+		: h / RADAU_SAFETY;
+	if (!std::isfinite(proposed) || proposed < RADAU_SAFETY * h) {
+		if (!std::isfinite(proposed))
+			proposed = RADAU_SAFETY * h;
+		return false;
+	}
+	errorEstimate = error;
+
+	// the state at the end of the step, and the series evaluated there as its acceleration
+	double positionTerms[RADAU_NODES - 1], velocityTerms[RADAU_NODES - 1];
+	for (int k = 0; k < RADAU_NODES - 1; k++) {
+		velocityTerms[k] = h / (k + 2);
+		positionTerms[k] = h * h / ((k + 2) * (k + 3));
+	}
+	double* position[3] = { s.px.data(), s.py.data(), s.pz.data() };
+	double* velocity[3] = { s.vx.data(), s.vy.data(), s.vz.data() };
+	double* accelerationOut[3] = { s.ax.data(), s.ay.data(), s.az.data() };
+
+	#pragma omp parallel for
+	for (int i = 0; i < n; i++) {
+		for (int axis = 0; axis < 3; axis++) {
+			size_t c = 3 * i + axis;
+			double dx = v0[c] * h + a0[c] * 0.5 * h * h;
+			double dv = a0[c] * h;
+			double a = a0[c];
+			for (int k = 0; k < RADAU_NODES - 1; k++) {
+				dx += b[k][c] * positionTerms[k];
+				dv += b[k][c] * velocityTerms[k];
+				a += b[k][c];
+			}
+			compensatedAdd(x0[c], compensatedX[c], dx);
+			compensatedAdd(v0[c], compensatedV[c], dv);
+			position[axis][i] = x0[c];
+			velocity[axis][i] = v0[c];
+			accelerationOut[axis][i] = a;
+		}
+	}
+	return true;
+}
+
+void GaussRadau::step(BodyStore& s, double interval) {
+	if (!initialized || count != 3 * s.size())
+		initialize(s);
+
+	int n = (int)s.size();
+	for (int i = 0; i < n; i++)
+		s.prevPosition[i] = s.position(i);
+
+	double done = 0.0;
+	size_t steps = 0;
+	bool last = false;
+	while (!last) {
+		double remaining = interval - done;
+		double h = dt > 0.0 ? dt : remaining;
+		if (h >= remaining) {
+			h = remaining;
+			last = true;
+		}
+
+		// forces at the start of the step
+		predict(s, h, 0.0);
+		evaluate(s);
+		const double* acceleration[3] = { s.ax.data(), s.ay.data(), s.az.data() };
+		for (int i = 0; i < n; i++) {
+			for (int axis = 0; axis < 3; axis++)
+				a0[3 * i + axis] = acceleration[axis][i];
+			s.torque[i] = glm::dvec3(s.tx[i], s.ty[i], s.tz[i]);
+			s.angularMomentum[i] += s.torque[i] * (0.5 * pendingKick);
+		}
+		pendingKick = 0.0;
+
+		// rejected steps are retried shorter, with the series started from nothing, as is a step
+		// far longer than the previous one, whose extrapolated series would be meaningless
+		double proposed;
+		bool clipped = last && dt > h;
+		if (lastStep > 0.0 && h < RADAU_MAX_GROWTH * lastStep)
+			extrapolate(h / lastStep);
+		else
+			clearSeries();
+		while (!attempt(s, h, proposed)) {
+			h = proposed;
+			last = false;
+			clipped = false;
+			clearSeries();
+		}
+
+		// a step cut short to end on the interval doesn't shrink the step of the next call
+		dt = clipped ? std::min(dt, proposed) : std::min(proposed, h / RADAU_SAFETY);
+		lastStep = h;
+		done += h;
+		steps++;
+		stepSize = h;
+
+		// rotation follows the leapfrog's kicks, with the closing one applied at the start of the next step
+		for (int i = 0; i < n; i++)
+			s.angularMomentum[i] += s.torque[i] * (0.5 * h);
+		rotateBodies(s, h);
+		pendingKick = h;
+	}
+
+	stepsTaken = steps;
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "forces.h"
+
+// substeps per step of the predictor-corrector, the order of the scheme is 2 * RADAU_NODES - 1
+const int RADAU_NODES = 8;
+const int RADAU_MAX_ITERATIONS = 12;
+// a step whose error estimate asks for less than this fraction of it is redone, and no step grows by more than its inverse
+const double RADAU_SAFETY = 0.25;
+// steps this many times longer than the previous one start without its extrapolated series
+const double RADAU_MAX_GROWTH = 20.0;
+
+extern double radauTolerance;	// epsilon of the step criterion, roughly the relative error allowed per step
+
+// IAS15 (Rein & Spiegel 2015): 15th-order implicit Runge-Kutta on Gauss-Radau spacings
+// the acceleration over a step is a polynomial in the fraction of the step, fitted through the forces at 8 nodes
+// and refined by predictor-corrector iterations; the derivatives of that polynomial give the shortest timescale
+// of the system, which sets the next step, so quiet stretches take long steps and close encounters short ones
+// the interval requested by the caller is covered with as many steps as needed, the last one cut to end on it
+class GaussRadau {
+public:
+	void step(BodyStore& s, double interval);
+	void reset() { initialized = false; }
+
+	double stepSize = 0.0;		// last step taken
+	double errorEstimate = 0.0;	// error estimate of the last step
+	size_t stepsTaken = 0;		// steps taken during the last call
+private:
+	bool initialized = false;
+	double dt = 0.0;			// next step suggested by the error control
+	double lastStep = 0.0;		// step the coefficients in b belong to
+	double pendingKick = 0.0;	// closing half-kick of the angular momentum, applied with the torque at the next step
+	size_t count = 0;			// components, three per body
+
+	std::vector<double> x0, v0, a0, compensatedX, compensatedV;
+	std::vector<double> b[RADAU_NODES - 1], g[RADAU_NODES - 1];
+
+	void initialize(BodyStore& s);
+	void clearSeries();
+	void predict(BodyStore& s, double h, double t);
+	void evaluate(BodyStore& s);
+	void extrapolate(double q);
+	bool attempt(BodyStore& s, double h, double& proposed);
+};
\ No newline at end of file
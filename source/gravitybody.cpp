@@ -11,7 +11,7 @@ GravityBody::GravityBody(double mass) {
 	gravityType = POINT;
 	radius = j2 = 0.0;
 	oblateness = 0.0f;
-	momentOfInertia = angularMomentum = torque = nextTorque = glm::dvec3(0.0);
+	momentOfInertia = angularMomentum = torque = glm::dvec3(0.0);
 }
 
 GravityBody::GravityBody(double mass, Orbit orbit, size_t parentIndex, bool addToBary) {
@@ -22,7 +22,7 @@ GravityBody::GravityBody(double mass, Orbit orbit, size_t parentIndex, bool addT
 	gravityType = POINT;
 	radius = j2 = 0.0;
 	oblateness = 0.0f;
-	momentOfInertia = angularMomentum = torque = nextTorque = glm::dvec3(0.0);
+	momentOfInertia = angularMomentum = torque = glm::dvec3(0.0);
 
 	glm::dvec3 parentPos, parentVel;
 	double parentMass;
@@ -178,7 +178,7 @@ void GravityBody::initI() {
 	}
 }
 
-glm::dquat GravityBody::rotateDeriv(const glm::dquat& orientation, const glm::dvec3& momentum) {
+glm::dquat GravityBody::rotateDeriv(const glm::dquat& orientation, const glm::dvec3& momentum, const glm::dvec3& momentOfInertia) {
 	glm::dmat3 rotMatrix = glm::mat3_cast(orientation);
 
 	glm::dvec3 momentumWorld = glm::transpose(rotMatrix) * momentum; // angular momentum in world frame
@@ -193,13 +193,18 @@ glm::dquat GravityBody::rotateDeriv(const glm::dquat& orientation, const glm::dv
 }
 
 void GravityBody::rotateRK4(double dt) {
-	glm::dquat k1 = rotateDeriv(rotQuat, angularMomentum);
-	glm::dquat k2 = rotateDeriv(glm::normalize(rotQuat + k1 * dt * 0.5), angularMomentum + torque * dt * 0.5);
-	glm::dquat k3 = rotateDeriv(glm::normalize(rotQuat + k2 * dt * 0.5), angularMomentum + torque * dt * 0.5);
-	glm::dquat k4 = rotateDeriv(glm::normalize(rotQuat + k3 * dt), angularMomentum + torque * dt);
+	rotQuat = rotateRK4(rotQuat, angularMomentum, torque, momentOfInertia, dt);
+}
+
+glm::dquat GravityBody::rotateRK4(const glm::dquat& orientation, const glm::dvec3& momentum,
+	const glm::dvec3& torque, const glm::dvec3& momentOfInertia, double dt) {
+	glm::dquat k1 = rotateDeriv(orientation, momentum, momentOfInertia);
+	glm::dquat k2 = rotateDeriv(glm::normalize(orientation + k1 * dt * 0.5), momentum + torque * dt * 0.5, momentOfInertia);
+	glm::dquat k3 = rotateDeriv(glm::normalize(orientation + k2 * dt * 0.5), momentum + torque * dt * 0.5, momentOfInertia);
+	glm::dquat k4 = rotateDeriv(glm::normalize(orientation + k3 * dt), momentum + torque * dt, momentOfInertia);
 
 	glm::dquat rotationChange = (k1 + k2 * 2.0 + k3 * 2.0 + k4) * (dt / 6.0);
-	rotQuat = glm::normalize(rotQuat + rotationChange);
+	return glm::normalize(orientation + rotationChange);
 }
 
 void GravityBody::draw(Shader& shader, uint8_t mode) {
@@ -18,6 +18,7 @@ protected:
 	size_t primary;
 public:
 	Trail* primaryOrbit;
+	virtual ~Barycenter() {}
 	virtual void add(size_t secondary) = 0;
 	virtual double mass(context& context) = 0;
 	virtual glm::dvec3 position(context& context) = 0;
@@ -25,6 +26,7 @@ public:
 	virtual double apparentMass(context& context, size_t observer) = 0;
 	virtual void positionOffset(context& context, glm::dvec3 offset) = 0;
 	virtual void velocityOffset(context& context, glm::dvec3 offset) = 0;
+	virtual void remap(const std::vector<size_t>& index) = 0;	// follow bodies to their indices after a merge
 };
 
 typedef struct orbit {
@@ -62,7 +64,7 @@ typedef struct orbit {
 
 class GravityBody : public Entity {
 public:
-	glm::dvec3 momentOfInertia, angularMomentum, torque, nextTorque;
+	glm::dvec3 momentOfInertia, angularMomentum, torque;
 	Trail* trail;
 	size_t parentIndex;
 	double mass, radius, j2;
@@ -80,10 +82,12 @@ public:
 
 	glm::dvec3 getRotVelocity();
 	void rotateRK4(double dt);
+	static glm::dquat rotateRK4(const glm::dquat& orientation, const glm::dvec3& momentum,
+		const glm::dvec3& torque, const glm::dvec3& momentOfInertia, double dt);
 
 	void draw(Shader& shader, uint8_t mode);
 private:
-	glm::dquat rotateDeriv(const glm::dquat& orientation, const glm::dvec3& momentum);
+	static glm::dquat rotateDeriv(const glm::dquat& orientation, const glm::dvec3& momentum, const glm::dvec3& momentOfInertia);
 };
 
 extern context bodies, frameBodies;
@@ -0,0 +1,935 @@
+#include "gravitykernel.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define KERNEL_X64
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC emits any intrinsic on request, GCC and Clang need the instruction set enabled per function
+#if defined(KERNEL_X64) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define TARGET_AVX2
+#define TARGET_AVX512
+#endif
+
+simd_level simdLevel = detectSimdLevel();
+
+// one interaction of the scalar kernel, i's share is gathered in registers by the caller
+static inline void pointPair(const BodyStore& s, double* ax, double* ay, double* az,
+	size_t i, size_t j, double& axi, double& ayi, double& azi) {
+	double dx = s.px[j] - s.px[i];
+	double dy = s.py[j] - s.py[i];
+	double dz = s.pz[j] - s.pz[i];
+	double invDistance = 1.0 / sqrt(dx * dx + dy * dy + dz * dz);
+	double field = G * invDistance * invDistance * invDistance;
+
+	axi += s.mass[j] * field * dx;
+	ayi += s.mass[j] * field * dy;
+	azi += s.mass[j] * field * dz;
+	ax[j] -= s.mass[i] * field * dx;
+	ay[j] -= s.mass[i] * field * dy;
+	az[j] -= s.mass[i] * field * dz;
+}
+
+static void pointGravityScalar(const BodyStore& s, double* ax, double* ay, double* az,
+	size_t iBegin, size_t iEnd, size_t jBegin, size_t jEnd) {
+	for (size_t i = iBegin; i < iEnd; i++) {
+		double axi = 0.0, ayi = 0.0, azi = 0.0;
+		for (size_t j = std::max(jBegin, i + 1); j < jEnd; j++)
+			pointPair(s, ax, ay, az, i, j, axi, ayi, azi);
+		ax[i] += axi;
+		ay[i] += ayi;
+		az[i] += azi;
+	}
+}
+
+// one interaction with jerk, G m (dv - 3 (d . dv) d / d^2) / d^3 for relative position d and velocity dv
+static inline void jerkPair(const BodyStore& s, ForceOutput out, size_t i, size_t j,
+	double& axi, double& ayi, double& azi, double& jxi, double& jyi, double& jzi) {
+	double dx = s.px[j] - s.px[i];
+	double dy = s.py[j] - s.py[i];
+	double dz = s.pz[j] - s.pz[i];
+	double dvx = s.vx[j] - s.vx[i];
+	double dvy = s.vy[j] - s.vy[i];
+	double dvz = s.vz[j] - s.vz[i];
+	double invDistance2 = 1.0 / (dx * dx + dy * dy + dz * dz);
+	double field = G * invDistance2 * sqrt(invDistance2);
+	double alpha = 3.0 * (dx * dvx + dy * dvy + dz * dvz) * invDistance2;
+	double kx = dvx - alpha * dx;
+	double ky = dvy - alpha * dy;
+	double kz = dvz - alpha * dz;
+
+	axi += s.mass[j] * field * dx;
+	ayi += s.mass[j] * field * dy;
+	azi += s.mass[j] * field * dz;
+	jxi += s.mass[j] * field * kx;
+	jyi += s.mass[j] * field * ky;
+	jzi += s.mass[j] * field * kz;
+	out.ax[j] -= s.mass[i] * field * dx;
+	out.ay[j] -= s.mass[i] * field * dy;
+	out.az[j] -= s.mass[i] * field * dz;
+	out.jx[j] -= s.mass[i] * field * kx;
+	out.jy[j] -= s.mass[i] * field * ky;
+	out.jz[j] -= s.mass[i] * field * kz;
+}
+
+static void pointJerkScalar(const BodyStore& s, ForceOutput out,
+	size_t iBegin, size_t iEnd, size_t jBegin, size_t jEnd) {
+	for (size_t i = iBegin; i < iEnd; i++) {
+		double axi = 0.0, ayi = 0.0, azi = 0.0, jxi = 0.0, jyi = 0.0, jzi = 0.0;
+		for (size_t j = std::max(jBegin, i + 1); j < jEnd; j++)
+			jerkPair(s, out, i, j, axi, ayi, azi, jxi, jyi, jzi);
+		out.ax[i] += axi;
+		out.ay[i] += ayi;
+		out.az[i] += azi;
+		out.jx[i] += jxi;
+		out.jy[i] += jyi;
+		out.jz[i] += jzi;
+	}
+}
+
+// point-mass field of every body at a position, skipping any body that sits exactly on it
+static glm::dvec3 pointFieldScalar(const BodyStore& s, double x, double y, double z) {
+	double ax = 0.0, ay = 0.0, az = 0.0;
+	for (size_t j = 0; j < s.size(); j++) {
+		double dx = s.px[j] - x;
+		double dy = s.py[j] - y;
+		double dz = s.pz[j] - z;
+		double d2 = dx * dx + dy * dy + dz * dz;
+		if (d2 == 0.0)
+			continue;
+		double invDistance = 1.0 / sqrt(d2);
+		double field = s.mass[j] * invDistance * invDistance * invDistance;
+		ax += field * dx;
+		ay += field * dy;
+		az += field * dz;
+	}
+	return G * glm::dvec3(ax, ay, az);
+}
+
+// field of every body at each target, skipping bodies that sit exactly on it
+static void targetFieldScalar(const BodyStore& s, const double* x, const double* y, const double* z,
+	double* ax, double* ay, double* az, size_t begin, size_t end) {
+	for (size_t i = begin; i < end; i++) {
+		glm::dvec3 field = pointFieldScalar(s, x[i], y[i], z[i]);
+		ax[i] = field.x;
+		ay[i] = field.y;
+		az[i] = field.z;
+	}
+}
+
+// single precision field at each target, with each body's G m rounded once
+static void targetFieldFloatScalar(const BodyStore& s, const float* x, const float* y, const float* z,
+	float* ax, float* ay, float* az, size_t begin, size_t end) {
+	for (size_t i = begin; i < end; i++) {
+		float sumX = 0.0f, sumY = 0.0f, sumZ = 0.0f;
+		for (size_t j = 0; j < s.size(); j++) {
+			float dx = (float)s.px[j] - x[i];
+			float dy = (float)s.py[j] - y[i];
+			float dz = (float)s.pz[j] - z[i];
+			float d2 = dx * dx + dy * dy + dz * dz;
+			if (d2 == 0.0f)
+				continue;
+			float invDistance = 1.0f / sqrtf(d2);
+			float field = (float)(G * s.mass[j]) * invDistance * invDistance * invDistance;
+			sumX += field * dx;
+			sumY += field * dy;
+			sumZ += field * dz;
+		}
+		ax[i] = sumX;
+		ay[i] = sumY;
+		az[i] = sumZ;
+	}
+}
+
+#ifdef KERNEL_X64
+// the reciprocal square root estimates are single precision (12 bits for SSE/AVX, 14 bits for AVX-512)
+// and each Newton iteration doubles the number of correct bits, so separations must stay within the
+// single precision range (roughly 1e-19 to 1e19 Mm) for the estimate to be meaningful
+
+static inline __m128d rsqrtSSE2(__m128d d2) {
+	const __m128d threeHalves = _mm_set1_pd(1.5);
+	__m128d half = _mm_mul_pd(_mm_set1_pd(0.5), d2);
+	__m128d y = _mm_cvtps_pd(_mm_rsqrt_ps(_mm_cvtpd_ps(d2)));
+	for (int k = 0; k < 3; k++)
+		y = _mm_mul_pd(y, _mm_sub_pd(threeHalves, _mm_mul_pd(half, _mm_mul_pd(y, y))));
+	return y;
+}
+
+static void pointGravitySSE2(const BodyStore& s, double* ax, double* ay, double* az,
+	size_t iBegin, size_t iEnd, size_t jBegin, size_t jEnd) {
+	const __m128d g = _mm_set1_pd(G);
+	const double* px = s.px.data();
+	const double* py = s.py.data();
+	const double* pz = s.pz.data();
+	const double* mass = s.mass.data();
+
+	for (size_t i = iBegin; i < iEnd; i++) {
+		__m128d xi = _mm_set1_pd(px[i]);
+		__m128d yi = _mm_set1_pd(py[i]);
+		__m128d zi = _mm_set1_pd(pz[i]);
+		__m128d mi = _mm_set1_pd(mass[i]);
+		__m128d sumX = _mm_setzero_pd(), sumY = _mm_setzero_pd(), sumZ = _mm_setzero_pd();
+
+		size_t j = std::max(jBegin, i + 1);
+		for (; j + 2 <= jEnd; j += 2) {
+			__m128d dx = _mm_sub_pd(_mm_loadu_pd(px + j), xi);
+			__m128d dy = _mm_sub_pd(_mm_loadu_pd(py + j), yi);
+			__m128d dz = _mm_sub_pd(_mm_loadu_pd(pz + j), zi);
+			__m128d d2 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)), _mm_mul_pd(dz, dz));
+			__m128d invDistance = rsqrtSSE2(d2);
+			__m128d field = _mm_mul_pd(g, _mm_mul_pd(invDistance, _mm_mul_pd(invDistance, invDistance)));
+
+			__m128d fieldJ = _mm_mul_pd(_mm_loadu_pd(mass + j), field);
+			sumX = _mm_add_pd(sumX, _mm_mul_pd(fieldJ, dx));
+			sumY = _mm_add_pd(sumY, _mm_mul_pd(fieldJ, dy));
+			sumZ = _mm_add_pd(sumZ, _mm_mul_pd(fieldJ, dz));
+
+			__m128d fieldI = _mm_mul_pd(mi, field);
+			_mm_storeu_pd(ax + j, _mm_sub_pd(_mm_loadu_pd(ax + j), _mm_mul_pd(fieldI, dx)));
+			_mm_storeu_pd(ay + j, _mm_sub_pd(_mm_loadu_pd(ay + j), _mm_mul_pd(fieldI, dy)));
+			_mm_storeu_pd(az + j, _mm_sub_pd(_mm_loadu_pd(az + j), _mm_mul_pd(fieldI, dz)));
+		}
+
+		double axi = _mm_cvtsd_f64(_mm_add_sd(sumX, _mm_unpackhi_pd(sumX, sumX)));
+		double ayi = _mm_cvtsd_f64(_mm_add_sd(sumY, _mm_unpackhi_pd(sumY, sumY)));
+		double azi = _mm_cvtsd_f64(_mm_add_sd(sumZ, _mm_unpackhi_pd(sumZ, sumZ)));
+		for (; j < jEnd; j++)
+			pointPair(s, ax, ay, az, i, j, axi, ayi, azi);
+
+		ax[i] += axi;
+		ay[i] += ayi;
+		az[i] += azi;
+	}
+}
+
+static glm::dvec3 pointFieldSSE2(const BodyStore& s, double x, double y, double z) {
+	const double* px = s.px.data();
+	const double* py = s.py.data();
+	const double* pz = s.pz.data();
+	const double* mass = s.mass.data();
+	size_t n = s.size();
+
+	__m128d xi = _mm_set1_pd(x), yi = _mm_set1_pd(y), zi = _mm_set1_pd(z);
+	__m128d sumX = _mm_setzero_pd(), sumY = _mm_setzero_pd(), sumZ = _mm_setzero_pd();
+	size_t j = 0;
+	for (; j + 2 <= n; j += 2) {
+		__m128d dx = _mm_sub_pd(_mm_loadu_pd(px + j), xi);
+		__m128d dy = _mm_sub_pd(_mm_loadu_pd(py + j), yi);
+		__m128d dz = _mm_sub_pd(_mm_loadu_pd(pz + j), zi);
+		__m128d d2 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)), _mm_mul_pd(dz, dz));
+		__m128d invDistance = rsqrtSSE2(d2);
+		__m128d field = _mm_mul_pd(_mm_loadu_pd(mass + j), _mm_mul_pd(invDistance, _mm_mul_pd(invDistance, invDistance)));
+		field = _mm_and_pd(field, _mm_cmpgt_pd(d2, _mm_setzero_pd()));
+
+		sumX = _mm_add_pd(sumX, _mm_mul_pd(field, dx));
+		sumY = _mm_add_pd(sumY, _mm_mul_pd(field, dy));
+		sumZ = _mm_add_pd(sumZ, _mm_mul_pd(field, dz));
+	}
+
+	glm::dvec3 acceleration(
+		_mm_cvtsd_f64(_mm_add_sd(sumX, _mm_unpackhi_pd(sumX, sumX))),
+		_mm_cvtsd_f64(_mm_add_sd(sumY, _mm_unpackhi_pd(sumY, sumY))),
+		_mm_cvtsd_f64(_mm_add_sd(sumZ, _mm_unpackhi_pd(sumZ, sumZ))));
+	acceleration *= G;
+	for (; j < n; j++) {
+		glm::dvec3 d = s.position(j) - glm::dvec3(x, y, z);
+		double d2 = glm::dot(d, d);
+		if (d2 > 0.0)
+			acceleration += d * (G * mass[j] / (d2 * sqrt(d2)));
+	}
+	return acceleration;
+}
+
+static void targetFieldSSE2(const BodyStore& s, const double* x, const double* y, const double* z,
+	double* ax, double* ay, double* az, size_t begin, size_t end) {
+	const double* px = s.px.data();
+	const double* py = s.py.data();
+	const double* pz = s.pz.data();
+	const double* mass = s.mass.data();
+	size_t n = s.size();
+	const __m128d g = _mm_set1_pd(G);
+
+	size_t i = begin;
+	for (; i + 2 <= end; i += 2) {
+		__m128d xi = _mm_loadu_pd(x + i), yi = _mm_loadu_pd(y + i), zi = _mm_loadu_pd(z + i);
+		__m128d sumX = _mm_setzero_pd(), sumY = _mm_setzero_pd(), sumZ = _mm_setzero_pd();
+		for (size_t j = 0; j < n; j++) {
+			__m128d dx = _mm_sub_pd(_mm_set1_pd(px[j]), xi);
+			__m128d dy = _mm_sub_pd(_mm_set1_pd(py[j]), yi);
+			__m128d dz = _mm_sub_pd(_mm_set1_pd(pz[j]), zi);
+			__m128d d2 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)), _mm_mul_pd(dz, dz));
+			__m128d invDistance = rsqrtSSE2(d2);
+			__m128d field = _mm_mul_pd(_mm_set1_pd(mass[j]), _mm_mul_pd(invDistance, _mm_mul_pd(invDistance, invDistance)));
+			field = _mm_and_pd(field, _mm_cmpgt_pd(d2, _mm_setzero_pd()));
+
+			sumX = _mm_add_pd(sumX, _mm_mul_pd(field, dx));
+			sumY = _mm_add_pd(sumY, _mm_mul_pd(field, dy));
+			sumZ = _mm_add_pd(sumZ, _mm_mul_pd(field, dz));
+		}
+		_mm_storeu_pd(ax + i, _mm_mul_pd(g, sumX));
+		_mm_storeu_pd(ay + i, _mm_mul_pd(g, sumY));
+		_mm_storeu_pd(az + i, _mm_mul_pd(g, sumZ));
+	}
+	for (; i < end; i++) {
+		glm::dvec3 field = pointFieldScalar(s, x[i], y[i], z[i]);
+		ax[i] = field.x;
+		ay[i] = field.y;
+		az[i] = field.z;
+	}
+}
+
+TARGET_AVX2 static inline __m256d rsqrtAVX2(__m256d d2) {
+	const __m256d threeHalves = _mm256_set1_pd(1.5);
+	__m256d half = _mm256_mul_pd(_mm256_set1_pd(0.5), d2);
+	__m256d y = _mm256_cvtps_pd(_mm_rsqrt_ps(_mm256_cvtpd_ps(d2)));
+	for (int k = 0; k < 3; k++)
+		y = _mm256_mul_pd(y, _mm256_sub_pd(threeHalves, _mm256_mul_pd(half, _mm256_mul_pd(y, y))));
+	return y;
+}
+
+TARGET_AVX2 static inline double sumAVX2(__m256d v) {
+	__m128d low = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+	return _mm_cvtsd_f64(_mm_add_sd(low, _mm_unpackhi_pd(low, low)));
+}
+
+TARGET_AVX2 static void pointGravityAVX2(const BodyStore& s, double* ax, double* ay, double* az,
+	size_t iBegin, size_t iEnd, size_t jBegin, size_t jEnd) {
+	const __m256d g = _mm256_set1_pd(G);
+	const double* px = s.px.data();
+	const double* py = s.py.data();
+	const double* pz = s.pz.data();
+	const double* mass = s.mass.data();
+
+	for (size_t i = iBegin; i < iEnd; i++) {
+		__m256d xi = _mm256_set1_pd(px[i]);
+		__m256d yi = _mm256_set1_pd(py[i]);
+		__m256d zi = _mm256_set1_pd(pz[i]);
+		__m256d mi = _mm256_set1_pd(mass[i]);
+		__m256d sumX = _mm256_setzero_pd(), sumY = _mm256_setzero_pd(), sumZ = _mm256_setzero_pd();
+
+		size_t j = std::max(jBegin, i + 1);
+		for (; j + 4 <= jEnd; j += 4) {
+			__m256d dx = _mm256_sub_pd(_mm256_loadu_pd(px + j), xi);
+			__m256d dy = _mm256_sub_pd(_mm256_loadu_pd(py + j), yi);
+			__m256d dz = _mm256_sub_pd(_mm256_loadu_pd(pz + j), zi);
+			__m256d d2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)), _mm256_mul_pd(dz, dz));
+			__m256d invDistance = rsqrtAVX2(d2);
+			__m256d field = _mm256_mul_pd(g, _mm256_mul_pd(invDistance, _mm256_mul_pd(invDistance, invDistance)));
+
+			__m256d fieldJ = _mm256_mul_pd(_mm256_loadu_pd(mass + j), field);
+			sumX = _mm256_add_pd(sumX, _mm256_mul_pd(fieldJ, dx));
+			sumY = _mm256_add_pd(sumY, _mm256_mul_pd(fieldJ, dy));
+			sumZ = _mm256_add_pd(sumZ, _mm256_mul_pd(fieldJ, dz));
+
+			__m256d fieldI = _mm256_mul_pd(mi, field);
+			_mm256_storeu_pd(ax + j, _mm256_sub_pd(_mm256_loadu_pd(ax + j), _mm256_mul_pd(fieldI, dx)));
+			_mm256_storeu_pd(ay + j, _mm256_sub_pd(_mm256_loadu_pd(ay + j), _mm256_mul_pd(fieldI, dy)));
+			_mm256_storeu_pd(az + j, _mm256_sub_pd(_mm256_loadu_pd(az + j), _mm256_mul_pd(fieldI, dz)));
+		}
+
+		double axi = sumAVX2(sumX);
+		double ayi = sumAVX2(sumY);
+		double azi = sumAVX2(sumZ);
+		for (; j < jEnd; j++)
+			pointPair(s, ax, ay, az, i, j, axi, ayi, azi);
+
+		ax[i] += axi;
+		ay[i] += ayi;
+		az[i] += azi;
+	}
+}
+
+TARGET_AVX2 static void pointJerkAVX2(const BodyStore& s, ForceOutput out,
+	size_t iBegin, size_t iEnd, size_t jBegin, size_t jEnd) {
+	const __m256d g = _mm256_set1_pd(G);
+	const __m256d three = _mm256_set1_pd(3.0);
+	const double* px = s.px.data();
+	const double* py = s.py.data();
+	const double* pz = s.pz.data();
+	const double* vx = s.vx.data();
+	const double* vy = s.vy.data();
+	const double* vz = s.vz.data();
+	const double* mass = s.mass.data();
+
+	for (size_t i = iBegin; i < iEnd; i++) {
+		__m256d xi = _mm256_set1_pd(px[i]), yi = _mm256_set1_pd(py[i]), zi = _mm256_set1_pd(pz[i]);
+		__m256d vxi = _mm256_set1_pd(vx[i]), vyi = _mm256_set1_pd(vy[i]), vzi = _mm256_set1_pd(vz[i]);
+		__m256d mi = _mm256_set1_pd(mass[i]);
+		__m256d sumX = _mm256_setzero_pd(), sumY = _mm256_setzero_pd(), sumZ = _mm256_setzero_pd();
+		__m256d jerkX = _mm256_setzero_pd(), jerkY = _mm256_setzero_pd(), jerkZ = _mm256_setzero_pd();
+
+		size_t j = std::max(jBegin, i + 1);
+		for (; j + 4 <= jEnd; j += 4) {
+			__m256d dx = _mm256_sub_pd(_mm256_loadu_pd(px + j), xi);
+			__m256d dy = _mm256_sub_pd(_mm256_loadu_pd(py + j), yi);
+			__m256d dz = _mm256_sub_pd(_mm256_loadu_pd(pz + j), zi);
+			__m256d dvx = _mm256_sub_pd(_mm256_loadu_pd(vx + j), vxi);
+			__m256d dvy = _mm256_sub_pd(_mm256_loadu_pd(vy + j), vyi);
+			__m256d dvz = _mm256_sub_pd(_mm256_loadu_pd(vz + j), vzi);
+			__m256d d2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)), _mm256_mul_pd(dz, dz));
+			__m256d invDistance = rsqrtAVX2(d2);
+			__m256d invDistance2 = _mm256_mul_pd(invDistance, invDistance);
+			__m256d field = _mm256_mul_pd(g, _mm256_mul_pd(invDistance, invDistance2));
+			__m256d rv = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx, dvx), _mm256_mul_pd(dy, dvy)), _mm256_mul_pd(dz, dvz));
+			__m256d alpha = _mm256_mul_pd(three, _mm256_mul_pd(rv, invDistance2));
+			__m256d kx = _mm256_sub_pd(dvx, _mm256_mul_pd(alpha, dx));
+			__m256d ky = _mm256_sub_pd(dvy, _mm256_mul_pd(alpha, dy));
+			__m256d kz = _mm256_sub_pd(dvz, _mm256_mul_pd(alpha, dz));
+
+			__m256d fieldJ = _mm256_mul_pd(_mm256_loadu_pd(mass + j), field);
+			sumX = _mm256_add_pd(sumX, _mm256_mul_pd(fieldJ, dx));
+			sumY = _mm256_add_pd(sumY, _mm256_mul_pd(fieldJ, dy));
+			sumZ = _mm256_add_pd(sumZ, _mm256_mul_pd(fieldJ, dz));
+			jerkX = _mm256_add_pd(jerkX, _mm256_mul_pd(fieldJ, kx));
+			jerkY = _mm256_add_pd(jerkY, _mm256_mul_pd(fieldJ, ky));
+			jerkZ = _mm256_add_pd(jerkZ, _mm256_mul_pd(fieldJ, kz));
+
+			__m256d fieldI = _mm256_mul_pd(mi, field);
+			_mm256_storeu_pd(out.ax + j, _mm256_sub_pd(_mm256_loadu_pd(out.ax + j), _mm256_mul_pd(fieldI, dx)));
+			_mm256_storeu_pd(out.ay + j, _mm256_sub_pd(_mm256_loadu_pd(out.ay + j), _mm256_mul_pd(fieldI, dy)));
+			_mm256_storeu_pd(out.az + j, _mm256_sub_pd(_mm256_loadu_pd(out.az + j), _mm256_mul_pd(fieldI, dz)));
+			_mm256_storeu_pd(out.jx + j, _mm256_sub_pd(_mm256_loadu_pd(out.jx + j), _mm256_mul_pd(fieldI, kx)));
+			_mm256_storeu_pd(out.jy + j, _mm256_sub_pd(_mm256_loadu_pd(out.jy + j), _mm256_mul_pd(fieldI, ky)));
+			_mm256_storeu_pd(out.jz + j, _mm256_sub_pd(_mm256_loadu_pd(out.jz + j), _mm256_mul_pd(fieldI, kz)));
+		}
+
+		double axi = sumAVX2(sumX), ayi = sumAVX2(sumY), azi = sumAVX2(sumZ);
+		double jxi = sumAVX2(jerkX), jyi = sumAVX2(jerkY), jzi = sumAVX2(jerkZ);
+		for (; j < jEnd; j++)
+			jerkPair(s, out, i, j, axi, ayi, azi, jxi, jyi, jzi);
+
+		out.ax[i] += axi;
+		out.ay[i] += ayi;
+		out.az[i] += azi;
+		out.jx[i] += jxi;
+		out.jy[i] += jyi;
+		out.jz[i] += jzi;
+	}
+}
+
+TARGET_AVX2 static glm::dvec3 pointFieldAVX2(const BodyStore& s, double x, double y, double z) {
+	const double* px = s.px.data();
+	const double* py = s.py.data();
+	const double* pz = s.pz.data();
+	const double* mass = s.mass.data();
+	size_t n = s.size();
+
+	__m256d xi = _mm256_set1_pd(x), yi = _mm256_set1_pd(y), zi = _mm256_set1_pd(z);
+	__m256d sumX = _mm256_setzero_pd(), sumY = _mm256_setzero_pd(), sumZ = _mm256_setzero_pd();
+	size_t j = 0;
+	for (; j + 4 <= n; j += 4) {
+		__m256d dx = _mm256_sub_pd(_mm256_loadu_pd(px + j), xi);
+		__m256d dy = _mm256_sub_pd(_mm256_loadu_pd(py + j), yi);
+		__m256d dz = _mm256_sub_pd(_mm256_loadu_pd(pz + j), zi);
+		__m256d d2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)), _mm256_mul_pd(dz, dz));
+		__m256d invDistance = rsqrtAVX2(d2);
+		__m256d field = _mm256_mul_pd(_mm256_loadu_pd(mass + j), _mm256_mul_pd(invDistance, _mm256_mul_pd(invDistance, invDistance)));
+		field = _mm256_and_pd(field, _mm256_cmp_pd(d2, _mm256_setzero_pd(), _CMP_GT_OQ));
+
+		sumX = _mm256_add_pd(sumX, _mm256_mul_pd(field, dx));
+		sumY = _mm256_add_pd(sumY, _mm256_mul_pd(field, dy));
+		sumZ = _mm256_add_pd(sumZ, _mm256_mul_pd(field, dz));
+	}
+
+	glm::dvec3 acceleration = G * glm::dvec3(sumAVX2(sumX), sumAVX2(sumY), sumAVX2(sumZ));
+	for (; j < n; j++) {
+		glm::dvec3 d = s.position(j) - glm::dvec3(x, y, z);
+		double d2 = glm::dot(d, d);
+		if (d2 > 0.0)
+			acceleration += d * (G * mass[j] / (d2 * sqrt(d2)));
+	}
+	return acceleration;
+}
+
+TARGET_AVX2 static void targetFieldAVX2(const BodyStore& s, const double* x, const double* y, const double* z,
+	double* ax, double* ay, double* az, size_t begin, size_t end) {
+	const double* px = s.px.data();
+	const double* py = s.py.data();
+	const double* pz = s.pz.data();
+	const double* mass = s.mass.data();
+	size_t n = s.size();
+	const __m256d g = _mm256_set1_pd(G);
+
+	size_t i = begin;
+	for (; i + 4 <= end; i += 4) {
+		__m256d xi = _mm256_loadu_pd(x + i), yi = _mm256_loadu_pd(y + i), zi = _mm256_loadu_pd(z + i);
+		__m256d sumX = _mm256_setzero_pd(), sumY = _mm256_setzero_pd(), sumZ = _mm256_setzero_pd();
+		for (size_t j = 0; j < n; j++) {
+			__m256d dx = _mm256_sub_pd(_mm256_set1_pd(px[j]), xi);
+			__m256d dy = _mm256_sub_pd(_mm256_set1_pd(py[j]), yi);
+			__m256d dz = _mm256_sub_pd(_mm256_set1_pd(pz[j]), zi);
+			__m256d d2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)), _mm256_mul_pd(dz, dz));
+			__m256d invDistance = rsqrtAVX2(d2);
+			__m256d field = _mm256_mul_pd(_mm256_set1_pd(mass[j]), _mm256_mul_pd(invDistance, _mm256_mul_pd(invDistance, invDistance)));
+			field = _mm256_and_pd(field, _mm256_cmp_pd(d2, _mm256_setzero_pd(), _CMP_GT_OQ));
+
+			sumX = _mm256_add_pd(sumX, _mm256_mul_pd(field, dx));
+			sumY = _mm256_add_pd(sumY, _mm256_mul_pd(field, dy));
+			sumZ = _mm256_add_pd(sumZ, _mm256_mul_pd(field, dz));
+		}
+		_mm256_storeu_pd(ax + i, _mm256_mul_pd(g, sumX));
+		_mm256_storeu_pd(ay + i, _mm256_mul_pd(g, sumY));
+		_mm256_storeu_pd(az + i, _mm256_mul_pd(g, sumZ));
+	}
+	for (; i < end; i++) {
+		glm::dvec3 field = pointFieldScalar(s, x[i], y[i], z[i]);
+		ax[i] = field.x;
+		ay[i] = field.y;
+		az[i] = field.z;
+	}
+}
+
+TARGET_AVX512 static inline __m512d rsqrtAVX512(__m512d d2) {
+	const __m512d threeHalves = _mm512_set1_pd(1.5);
+	__m512d half = _mm512_mul_pd(_mm512_set1_pd(0.5), d2);
+	__m512d y = _mm512_rsqrt14_pd(d2);
+	for (int k = 0; k < 2; k++)
+		y = _mm512_mul_pd(y, _mm512_sub_pd(threeHalves, _mm512_mul_pd(half, _mm512_mul_pd(y, y))));
+	return y;
+}
+
+TARGET_AVX512 static void pointGravityAVX512(const BodyStore& s, double* ax, double* ay, double* az,
+	size_t iBegin, size_t iEnd, size_t jBegin, size_t jEnd) {
+	const __m512d g = _mm512_set1_pd(G);
+	const double* px = s.px.data();
+	const double* py = s.py.data();
+	const double* pz = s.pz.data();
+	const double* mass = s.mass.data();
+
+	for (size_t i = iBegin; i < iEnd; i++) {
+		__m512d xi = _mm512_set1_pd(px[i]);
+		__m512d yi = _mm512_set1_pd(py[i]);
+		__m512d zi = _mm512_set1_pd(pz[i]);
+		__m512d mi = _mm512_set1_pd(mass[i]);
+		__m512d sumX = _mm512_setzero_pd(), sumY = _mm512_setzero_pd(), sumZ = _mm512_setzero_pd();
+
+		size_t j = std::max(jBegin, i + 1);
+		for (; j + 8 <= jEnd; j += 8) {
+			__m512d dx = _mm512_sub_pd(_mm512_loadu_pd(px + j), xi);
+			__m512d dy = _mm512_sub_pd(_mm512_loadu_pd(py + j), yi);
+			__m512d dz = _mm512_sub_pd(_mm512_loadu_pd(pz + j), zi);
+			__m512d d2 = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(dx, dx), _mm512_mul_pd(dy, dy)), _mm512_mul_pd(dz, dz));
+			__m512d invDistance = rsqrtAVX512(d2);
+			__m512d field = _mm512_mul_pd(g, _mm512_mul_pd(invDistance, _mm512_mul_pd(invDistance, invDistance)));
+
+			__m512d fieldJ = _mm512_mul_pd(_mm512_loadu_pd(mass + j), field);
+			sumX = _mm512_add_pd(sumX, _mm512_mul_pd(fieldJ, dx));
+			sumY = _mm512_add_pd(sumY, _mm512_mul_pd(fieldJ, dy));
+			sumZ = _mm512_add_pd(sumZ, _mm512_mul_pd(fieldJ, dz));
+
+			__m512d fieldI = _mm512_mul_pd(mi, field);
+			_mm512_storeu_pd(ax + j, _mm512_sub_pd(_mm512_loadu_pd(ax + j), _mm512_mul_pd(fieldI, dx)));
+			_mm512_storeu_pd(ay + j, _mm512_sub_pd(_mm512_loadu_pd(ay + j), _mm512_mul_pd(fieldI, dy)));
+			_mm512_storeu_pd(az + j, _mm512_sub_pd(_mm512_loadu_pd(az + j), _mm512_mul_pd(fieldI, dz)));
+		}
+
+		double axi = _mm512_reduce_add_pd(sumX);
+		double ayi = _mm512_reduce_add_pd(sumY);
+		double azi = _mm512_reduce_add_pd(sumZ);
+		for (; j < jEnd; j++)
+			pointPair(s, ax, ay, az, i, j, axi, ayi, azi);
+
+		ax[i] += axi;
+		ay[i] += ayi;
+		az[i] += azi;
+	}
+}
+TARGET_AVX512 static void pointJerkAVX512(const BodyStore& s, ForceOutput out,
+	size_t iBegin, size_t iEnd, size_t jBegin, size_t jEnd) {
+	const __m512d g = _mm512_set1_pd(G);
+	const __m512d three = _mm512_set1_pd(3.0);
+	const double* px = s.px.data();
+	const double* py = s.py.data();
+	const double* pz = s.pz.data();
+	const double* vx = s.vx.data();
+	const double* vy = s.vy.data();
+	const double* vz = s.vz.data();
+	const double* mass = s.mass.data();
+
+	for (size_t i = iBegin; i < iEnd; i++) {
+		__m512d xi = _mm512_set1_pd(px[i]), yi = _mm512_set1_pd(py[i]), zi = _mm512_set1_pd(pz[i]);
+		__m512d vxi = _mm512_set1_pd(vx[i]), vyi = _mm512_set1_pd(vy[i]), vzi = _mm512_set1_pd(vz[i]);
+		__m512d mi = _mm512_set1_pd(mass[i]);
+		__m512d sumX = _mm512_setzero_pd(), sumY = _mm512_setzero_pd(), sumZ = _mm512_setzero_pd();
+		__m512d jerkX = _mm512_setzero_pd(), jerkY = _mm512_setzero_pd(), jerkZ = _mm512_setzero_pd();
+
+		size_t j = std::max(jBegin, i + 1);
+		for (; j + 8 <= jEnd; j += 8) {
+			__m512d dx = _mm512_sub_pd(_mm512_loadu_pd(px + j), xi);
+			__m512d dy = _mm512_sub_pd(_mm512_loadu_pd(py + j), yi);
+			__m512d dz = _mm512_sub_pd(_mm512_loadu_pd(pz + j), zi);
+			__m512d dvx = _mm512_sub_pd(_mm512_loadu_pd(vx + j), vxi);
+			__m512d dvy = _mm512_sub_pd(_mm512_loadu_pd(vy + j), vyi);
+			__m512d dvz = _mm512_sub_pd(_mm512_loadu_pd(vz + j), vzi);
+			__m512d d2 = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(dx, dx), _mm512_mul_pd(dy, dy)), _mm512_mul_pd(dz, dz));
+			__m512d invDistance = rsqrtAVX512(d2);
+			__m512d invDistance2 = _mm512_mul_pd(invDistance, invDistance);
+			__m512d field = _mm512_mul_pd(g, _mm512_mul_pd(invDistance, invDistance2));
+			__m512d rv = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(dx, dvx), _mm512_mul_pd(dy, dvy)), _mm512_mul_pd(dz, dvz));
+			__m512d alpha = _mm512_mul_pd(three, _mm512_mul_pd(rv, invDistance2));
+			__m512d kx = _mm512_sub_pd(dvx, _mm512_mul_pd(alpha, dx));
+			__m512d ky = _mm512_sub_pd(dvy, _mm512_mul_pd(alpha, dy));
+			__m512d kz = _mm512_sub_pd(dvz, _mm512_mul_pd(alpha, dz));
+
+			__m512d fieldJ = _mm512_mul_pd(_mm512_loadu_pd(mass + j), field);
+			sumX = _mm512_add_pd(sumX, _mm512_mul_pd(fieldJ, dx));
+			sumY = _mm512_add_pd(sumY, _mm512_mul_pd(fieldJ, dy));
+			sumZ = _mm512_add_pd(sumZ, _mm512_mul_pd(fieldJ, dz));
+			jerkX = _mm512_add_pd(jerkX, _mm512_mul_pd(fieldJ, kx));
+			jerkY = _mm512_add_pd(jerkY, _mm512_mul_pd(fieldJ, ky));
+			jerkZ = _mm512_add_pd(jerkZ, _mm512_mul_pd(fieldJ, kz));
+
+			__m512d fieldI = _mm512_mul_pd(mi, field);
+			_mm512_storeu_pd(out.ax + j, _mm512_sub_pd(_mm512_loadu_pd(out.ax + j), _mm512_mul_pd(fieldI, dx)));
+			_mm512_storeu_pd(out.ay + j, _mm512_sub_pd(_mm512_loadu_pd(out.ay + j), _mm512_mul_pd(fieldI, dy)));
+			_mm512_storeu_pd(out.az + j, _mm512_sub_pd(_mm512_loadu_pd(out.az + j), _mm512_mul_pd(fieldI, dz)));
+			_mm512_storeu_pd(out.jx + j, _mm512_sub_pd(_mm512_loadu_pd(out.jx + j), _mm512_mul_pd(fieldI, kx)));
+			_mm512_storeu_pd(out.jy + j, _mm512_sub_pd(_mm512_loadu_pd(out.jy + j), _mm512_mul_pd(fieldI, ky)));
+			_mm512_storeu_pd(out.jz + j, _mm512_sub_pd(_mm512_loadu_pd(out.jz + j), _mm512_mul_pd(fieldI, kz)));
+		}
+
+		double axi = _mm512_reduce_add_pd(sumX), ayi = _mm512_reduce_add_pd(sumY), azi = _mm512_reduce_add_pd(sumZ);
+		double jxi = _mm512_reduce_add_pd(jerkX), jyi = _mm512_reduce_add_pd(jerkY), jzi = _mm512_reduce_add_pd(jerkZ);
+		for (; j < jEnd; j++)
+			jerkPair(s, out, i, j, axi, ayi, azi, jxi, jyi, jzi);
+
+		out.ax[i] += axi;
+		out.ay[i] += ayi;
+		out.az[i] += azi;
+		out.jx[i] += jxi;
+		out.jy[i] += jyi;
+		out.jz[i] += jzi;
+	}
+}
+
+TARGET_AVX512 static glm::dvec3 pointFieldAVX512(const BodyStore& s, double x, double y, double z) {
+	const double* px = s.px.data();
+	const double* py = s.py.data();
+	const double* pz = s.pz.data();
+	const double* mass = s.mass.data();
+	size_t n = s.size();
+
+	__m512d xi = _mm512_set1_pd(x), yi = _mm512_set1_pd(y), zi = _mm512_set1_pd(z);
+	__m512d sumX = _mm512_setzero_pd(), sumY = _mm512_setzero_pd(), sumZ = _mm512_setzero_pd();
+	size_t j = 0;
+	for (; j + 8 <= n; j += 8) {
+		__m512d dx = _mm512_sub_pd(_mm512_loadu_pd(px + j), xi);
+		__m512d dy = _mm512_sub_pd(_mm512_loadu_pd(py + j), yi);
+		__m512d dz = _mm512_sub_pd(_mm512_loadu_pd(pz + j), zi);
+		__m512d d2 = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(dx, dx), _mm512_mul_pd(dy, dy)), _mm512_mul_pd(dz, dz));
+		__m512d invDistance = rsqrtAVX512(d2);
+		__m512d field = _mm512_mul_pd(_mm512_loadu_pd(mass + j), _mm512_mul_pd(invDistance, _mm512_mul_pd(invDistance, invDistance)));
+		field = _mm512_maskz_mov_pd(_mm512_cmp_pd_mask(d2, _mm512_setzero_pd(), _CMP_GT_OQ), field);
+
+		sumX = _mm512_add_pd(sumX, _mm512_mul_pd(field, dx));
+		sumY = _mm512_add_pd(sumY, _mm512_mul_pd(field, dy));
+		sumZ = _mm512_add_pd(sumZ, _mm512_mul_pd(field, dz));
+	}
+
+	glm::dvec3 acceleration = G * glm::dvec3(_mm512_reduce_add_pd(sumX), _mm512_reduce_add_pd(sumY), _mm512_reduce_add_pd(sumZ));
+	for (; j < n; j++) {
+		glm::dvec3 d = s.position(j) - glm::dvec3(x, y, z);
+		double d2 = glm::dot(d, d);
+		if (d2 > 0.0)
+			acceleration += d * (G * mass[j] / (d2 * sqrt(d2)));
+	}
+	return acceleration;
+}
+
+TARGET_AVX512 static void targetFieldAVX512(const BodyStore& s, const double* x, const double* y, const double* z,
+	double* ax, double* ay, double* az, size_t begin, size_t end) {
+	const double* px = s.px.data();
+	const double* py = s.py.data();
+	const double* pz = s.pz.data();
+	const double* mass = s.mass.data();
+	size_t n = s.size();
+	const __m512d g = _mm512_set1_pd(G);
+
+	size_t i = begin;
+	for (; i + 8 <= end; i += 8) {
+		__m512d xi = _mm512_loadu_pd(x + i), yi = _mm512_loadu_pd(y + i), zi = _mm512_loadu_pd(z + i);
+		__m512d sumX = _mm512_setzero_pd(), sumY = _mm512_setzero_pd(), sumZ = _mm512_setzero_pd();
+		for (size_t j = 0; j < n; j++) {
+			__m512d dx = _mm512_sub_pd(_mm512_set1_pd(px[j]), xi);
+			__m512d dy = _mm512_sub_pd(_mm512_set1_pd(py[j]), yi);
+			__m512d dz = _mm512_sub_pd(_mm512_set1_pd(pz[j]), zi);
+			__m512d d2 = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(dx, dx), _mm512_mul_pd(dy, dy)), _mm512_mul_pd(dz, dz));
+			__m512d invDistance = rsqrtAVX512(d2);
+			__m512d field = _mm512_mul_pd(_mm512_set1_pd(mass[j]), _mm512_mul_pd(invDistance, _mm512_mul_pd(invDistance, invDistance)));
+			field = _mm512_maskz_mov_pd(_mm512_cmp_pd_mask(d2, _mm512_setzero_pd(), _CMP_GT_OQ), field);
+
+			sumX = _mm512_add_pd(sumX, _mm512_mul_pd(field, dx));
+			sumY = _mm512_add_pd(sumY, _mm512_mul_pd(field, dy));
+			sumZ = _mm512_add_pd(sumZ, _mm512_mul_pd(field, dz));
+		}
+		_mm512_storeu_pd(ax + i, _mm512_mul_pd(g, sumX));
+		_mm512_storeu_pd(ay + i, _mm512_mul_pd(g, sumY));
+		_mm512_storeu_pd(az + i, _mm512_mul_pd(g, sumZ));
+	}
+	for (; i < end; i++) {
+		glm::dvec3 field = pointFieldScalar(s, x[i], y[i], z[i]);
+		ax[i] = field.x;
+		ay[i] = field.y;
+		az[i] = field.z;
+	}
+}
+
+// single precision reciprocal square roots: one Newton iteration brings the estimate to full float precision
+
+static inline __m128 rsqrtFloatSSE(__m128 d2) {
+	__m128 y = _mm_rsqrt_ps(d2);
+	return _mm_mul_ps(y, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), d2), _mm_mul_ps(y, y))));
+}
+
+TARGET_AVX2 static inline __m256 rsqrtFloatAVX2(__m256 d2) {
+	__m256 y = _mm256_rsqrt_ps(d2);
+	return _mm256_mul_ps(y, _mm256_sub_ps(_mm256_set1_ps(1.5f), _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), d2), _mm256_mul_ps(y, y))));
+}
+
+TARGET_AVX512 static inline __m512 rsqrtFloatAVX512(__m512 d2) {
+	__m512 y = _mm512_rsqrt14_ps(d2);
+	return _mm512_mul_ps(y, _mm512_sub_ps(_mm512_set1_ps(1.5f), _mm512_mul_ps(_mm512_mul_ps(_mm512_set1_ps(0.5f), d2), _mm512_mul_ps(y, y))));
+}
+
+static void targetFieldFloatSSE2(const BodyStore& s, const float* x, const float* y, const float* z,
+	float* ax, float* ay, float* az, size_t begin, size_t end) {
+	size_t n = s.size();
+
+	size_t i = begin;
+	for (; i + 4 <= end; i += 4) {
+		__m128 xi = _mm_loadu_ps(x + i), yi = _mm_loadu_ps(y + i), zi = _mm_loadu_ps(z + i);
+		__m128 sumX = _mm_setzero_ps(), sumY = _mm_setzero_ps(), sumZ = _mm_setzero_ps();
+		for (size_t j = 0; j < n; j++) {
+			__m128 dx = _mm_sub_ps(_mm_set1_ps((float)s.px[j]), xi);
+			__m128 dy = _mm_sub_ps(_mm_set1_ps((float)s.py[j]), yi);
+			__m128 dz = _mm_sub_ps(_mm_set1_ps((float)s.pz[j]), zi);
+			__m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+			__m128 invDistance = rsqrtFloatSSE(d2);
+			__m128 field = _mm_mul_ps(_mm_set1_ps((float)(G * s.mass[j])), _mm_mul_ps(invDistance, _mm_mul_ps(invDistance, invDistance)));
+			field = _mm_and_ps(field, _mm_cmpgt_ps(d2, _mm_setzero_ps()));
+
+			sumX = _mm_add_ps(sumX, _mm_mul_ps(field, dx));
+			sumY = _mm_add_ps(sumY, _mm_mul_ps(field, dy));
+			sumZ = _mm_add_ps(sumZ, _mm_mul_ps(field, dz));
+		}
+		_mm_storeu_ps(ax + i, sumX);
+		_mm_storeu_ps(ay + i, sumY);
+		_mm_storeu_ps(az + i, sumZ);
+	}
+	targetFieldFloatScalar(s, x, y, z, ax, ay, az, i, end);
+}
+
+TARGET_AVX2 static void targetFieldFloatAVX2(const BodyStore& s, const float* x, const float* y, const float* z,
+	float* ax, float* ay, float* az, size_t begin, size_t end) {
+	size_t n = s.size();
+
+	size_t i = begin;
+	for (; i + 8 <= end; i += 8) {
+		__m256 xi = _mm256_loadu_ps(x + i), yi = _mm256_loadu_ps(y + i), zi = _mm256_loadu_ps(z + i);
+		__m256 sumX = _mm256_setzero_ps(), sumY = _mm256_setzero_ps(), sumZ = _mm256_setzero_ps();
+		for (size_t j = 0; j < n; j++) {
+			__m256 dx = _mm256_sub_ps(_mm256_set1_ps((float)s.px[j]), xi);
+			__m256 dy = _mm256_sub_ps(_mm256_set1_ps((float)s.py[j]), yi);
+			__m256 dz = _mm256_sub_ps(_mm256_set1_ps((float)s.pz[j]), zi);
+			__m256 d2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+			__m256 invDistance = rsqrtFloatAVX2(d2);
+			__m256 field = _mm256_mul_ps(_mm256_set1_ps((float)(G * s.mass[j])), _mm256_mul_ps(invDistance, _mm256_mul_ps(invDistance, invDistance)));
+			field = _mm256_and_ps(field, _mm256_cmp_ps(d2, _mm256_setzero_ps(), _CMP_GT_OQ));
+
+			sumX = _mm256_add_ps(sumX, _mm256_mul_ps(field, dx));
+			sumY = _mm256_add_ps(sumY, _mm256_mul_ps(field, dy));
+			sumZ = _mm256_add_ps(sumZ, _mm256_mul_ps(field, dz));
+		}
+		_mm256_storeu_ps(ax + i, sumX);
+		_mm256_storeu_ps(ay + i, sumY);
+		_mm256_storeu_ps(az + i, sumZ);
+	}
+	targetFieldFloatScalar(s, x, y, z, ax, ay, az, i, end);
+}
+
+TARGET_AVX512 static void targetFieldFloatAVX512(const BodyStore& s, const float* x, const float* y, const float* z,
+	float* ax, float* ay, float* az, size_t begin, size_t end) {
+	size_t n = s.size();
+
+	size_t i = begin;
+	for (; i + 16 <= end; i += 16) {
+		__m512 xi = _mm512_loadu_ps(x + i), yi = _mm512_loadu_ps(y + i), zi = _mm512_loadu_ps(z + i);
+		__m512 sumX = _mm512_setzero_ps(), sumY = _mm512_setzero_ps(), sumZ = _mm512_setzero_ps();
+		for (size_t j = 0; j < n; j++) {
+			__m512 dx = _mm512_sub_ps(_mm512_set1_ps((float)s.px[j]), xi);
+			__m512 dy = _mm512_sub_ps(_mm512_set1_ps((float)s.py[j]), yi);
+			__m512 dz = _mm512_sub_ps(_mm512_set1_ps((float)s.pz[j]), zi);
+			__m512 d2 = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(dx, dx), _mm512_mul_ps(dy, dy)), _mm512_mul_ps(dz, dz));
+			__m512 invDistance = rsqrtFloatAVX512(d2);
+			__m512 field = _mm512_mul_ps(_mm512_set1_ps((float)(G * s.mass[j])), _mm512_mul_ps(invDistance, _mm512_mul_ps(invDistance, invDistance)));
+			field = _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(d2, _mm512_setzero_ps(), _CMP_GT_OQ), field);
+
+			sumX = _mm512_add_ps(sumX, _mm512_mul_ps(field, dx));
+			sumY = _mm512_add_ps(sumY, _mm512_mul_ps(field, dy));
+			sumZ = _mm512_add_ps(sumZ, _mm512_mul_ps(field, dz));
+		}
+		_mm512_storeu_ps(ax + i, sumX);
+		_mm512_storeu_ps(ay + i, sumY);
+		_mm512_storeu_ps(az + i, sumZ);
+	}
+	targetFieldFloatScalar(s, x, y, z, ax, ay, az, i, end);
+}
+#endif
+
+simd_level detectSimdLevel() {
+#if defined(KERNEL_X64) && defined(_MSC_VER)
+	int info[4];
+	__cpuidex(info, 0, 0);
+	int maxLeaf = info[0];
+
+	__cpuidex(info, 1, 0);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+
+	bool avx2 = false, avx512 = false;
+	if (maxLeaf >= 7) {
+		__cpuidex(info, 7, 0);
+		avx2 = (info[1] & (1 << 5)) != 0;
+		avx512 = (info[1] & (1 << 16)) != 0;
+	}
+
+	// the operating system must also preserve the wider registers across context switches
+	if (avx512 && (xcr0 & 0xe6) == 0xe6)
+		return SIMD_AVX512;
+	if (avx && avx2 && (xcr0 & 0x06) == 0x06)
+		return SIMD_AVX2;
+	return SIMD_SSE2;
+#elif defined(KERNEL_X64)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f"))
+		return SIMD_AVX512;
+	if (__builtin_cpu_supports("avx2"))
+		return SIMD_AVX2;
+	return SIMD_SSE2;
+#else
+	return SIMD_SCALAR;
+#endif
+}
+
+const char* simdLevelName(simd_level level) {
+	switch (level) {
+	case SIMD_SSE2:
+		return "SSE2";
+	case SIMD_AVX2:
+		return "AVX2";
+	case SIMD_AVX512:
+		return "AVX-512";
+	default:
+		return "scalar";
+	}
+}
+
+pointGravityKernel selectPointGravityKernel(simd_level level) {
+#ifdef KERNEL_X64
+	switch (level) {
+	case SIMD_SSE2:
+		return pointGravitySSE2;
+	case SIMD_AVX2:
+		return pointGravityAVX2;
+	case SIMD_AVX512:
+		return pointGravityAVX512;
+	default:
+		break;
+	}
+#endif
+	return pointGravityScalar;
+}
+
+void pointGravity(const BodyStore& s, double* ax, double* ay, double* az,
+	size_t iBegin, size_t iEnd, size_t jBegin, size_t jEnd) {
+	selectPointGravityKernel(simdLevel)(s, ax, ay, az, iBegin, iEnd, jBegin, jEnd);
+}
+
+pointFieldKernel selectPointFieldKernel(simd_level level) {
+#ifdef KERNEL_X64
+	switch (level) {
+	case SIMD_SSE2:
+		return pointFieldSSE2;
+	case SIMD_AVX2:
+		return pointFieldAVX2;
+	case SIMD_AVX512:
+		return pointFieldAVX512;
+	default:
+		break;
+	}
+#endif
+	return pointFieldScalar;
+}
+
+glm::dvec3 pointField(const BodyStore& s, const glm::dvec3& position) {
+	return selectPointFieldKernel(simdLevel)(s, position.x, position.y, position.z);
+}
+
+// SSE2 machines use the scalar jerk kernel
+pointJerkKernel selectPointJerkKernel(simd_level level) {
+#ifdef KERNEL_X64
+	switch (level) {
+	case SIMD_AVX2:
+		return pointJerkAVX2;
+	case SIMD_AVX512:
+		return pointJerkAVX512;
+	default:
+		break;
+	}
+#endif
+	return pointJerkScalar;
+}
+
+void pointJerk(const BodyStore& s, ForceOutput out,
+	size_t iBegin, size_t iEnd, size_t jBegin, size_t jEnd) {
+	selectPointJerkKernel(simdLevel)(s, out, iBegin, iEnd, jBegin, jEnd);
+}
+
+targetFieldKernel selectTargetFieldKernel(simd_level level) {
+#ifdef KERNEL_X64
+	switch (level) {
+	case SIMD_SSE2:
+		return targetFieldSSE2;
+	case SIMD_AVX2:
+		return targetFieldAVX2;
+	case SIMD_AVX512:
+		return targetFieldAVX512;
+	default:
+		break;
+	}
+#endif
+	return targetFieldScalar;
+}
+
+void targetField(const BodyStore& s, const double* x, const double* y, const double* z,
+	double* ax, double* ay, double* az, size_t begin, size_t end) {
+	selectTargetFieldKernel(simdLevel)(s, x, y, z, ax, ay, az, begin, end);
+}
+
+targetFieldFloatKernel selectTargetFieldFloatKernel(simd_level level) {
+#ifdef KERNEL_X64
+	switch (level) {
+	case SIMD_SSE2:
+		return targetFieldFloatSSE2;
+	case SIMD_AVX2:
+		return targetFieldFloatAVX2;
+	case SIMD_AVX512:
+		return targetFieldFloatAVX512;
+	default:
+		break;
+	}
+#endif
+	return targetFieldFloatScalar;
+}
+
+void targetField(const BodyStore& s, const float* x, const float* y, const float* z,
+	float* ax, float* ay, float* az, size_t begin, size_t end) {
+	selectTargetFieldFloatKernel(simdLevel)(s, x, y, z, ax, ay, az, begin, end);
+}
\ No newline at end of file
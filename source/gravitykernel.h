@@ -0,0 +1,64 @@
+#pragma once
+
+#include "bodystore.h"
+
+enum simd_level : uint8_t {
+	SIMD_SCALAR,
+	SIMD_SSE2,
+	SIMD_AVX2,
+	SIMD_AVX512
+};
+
+// accumulates point-mass accelerations for every pair (i, j) with i in [iBegin, iEnd), j in [jBegin, jEnd) and j > i
+// both sides of each pair are written, so a single call over a triangle of pairs applies Newton's third law
+//
+// vector kernels use a reciprocal square root estimate refined by Newton iterations and agree with the
+// scalar kernel to within 1e-14 relative error per interaction; summed accelerations differ only by
+// reordering of the additions, which stays below KERNEL_TOLERANCE relative for the scenes the builder creates,
+// as the microbenchmarks check on every run
+const double KERNEL_TOLERANCE = 1e-12;
+
+using pointGravityKernel = void (*)(const BodyStore& s, double* ax, double* ay, double* az,
+	size_t iBegin, size_t iEnd, size_t jBegin, size_t jEnd);
+
+// accumulators of the jerk kernel
+struct ForceOutput {
+	double *ax, *ay, *az, *jx, *jy, *jz;
+};
+
+// as the point gravity kernel, also accumulating the jerk from the relative velocities of each pair
+using pointJerkKernel = void (*)(const BodyStore& s, ForceOutput out,
+	size_t iBegin, size_t iEnd, size_t jBegin, size_t jEnd);
+
+// point-mass acceleration at a position from every body in the store, one-sided and skipping any body at
+// exactly that position, so a body of the store can be passed as its own target
+using pointFieldKernel = glm::dvec3 (*)(const BodyStore& s, double x, double y, double z);
+
+// point-mass accelerations written for the targets in [begin, end) of separate position arrays, from every body
+// in the store; vectorized over the targets rather than the bodies, so a few massive bodies still fill the lanes
+using targetFieldKernel = void (*)(const BodyStore& s, const double* x, const double* y, const double* z,
+	double* ax, double* ay, double* az, size_t begin, size_t end);
+
+// the target field in single precision, twice as many targets per vector; rounding limits it to about 1e-7 relative
+using targetFieldFloatKernel = void (*)(const BodyStore& s, const float* x, const float* y, const float* z,
+	float* ax, float* ay, float* az, size_t begin, size_t end);
+
+extern simd_level simdLevel;
+
+simd_level detectSimdLevel();
+const char* simdLevelName(simd_level level);
+pointGravityKernel selectPointGravityKernel(simd_level level);
+pointFieldKernel selectPointFieldKernel(simd_level level);
+pointJerkKernel selectPointJerkKernel(simd_level level);
+targetFieldKernel selectTargetFieldKernel(simd_level level);
+targetFieldFloatKernel selectTargetFieldFloatKernel(simd_level level);
+
+void pointGravity(const BodyStore& s, double* ax, double* ay, double* az,
+	size_t iBegin, size_t iEnd, size_t jBegin, size_t jEnd);
+void pointJerk(const BodyStore& s, ForceOutput out,
+	size_t iBegin, size_t iEnd, size_t jBegin, size_t jEnd);
+glm::dvec3 pointField(const BodyStore& s, const glm::dvec3& position);
+void targetField(const BodyStore& s, const double* x, const double* y, const double* z,
+	double* ax, double* ay, double* az, size_t begin, size_t end);
+void targetField(const BodyStore& s, const float* x, const float* y, const float* z,
+	float* ax, float* ay, float* az, size_t begin, size_t end);
\ No newline at end of file
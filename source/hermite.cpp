@@ -0,0 +1,72 @@
+#include "hermite.h"
+#include "rotation.h"
+
+// accelerations and jerks of the current state, which every later step carries over from its corrector
+void HermiteIntegrator::initialize(BodyStore& s) {
+	s.clearForces();
+	directForces(s, true);
+	for (size_t i = 0; i < s.size(); i++)
+		s.torque[i] = glm::dvec3(s.tx[i], s.ty[i], s.tz[i]);
+	initialized = true;
+}
+
+void HermiteIntegrator::step(BodyStore& s, double dt) {
+	if (!initialized || x.size() != s.size()) {
+		size_t n = s.size();
+		for (std::vector<double>* field : { &x, &y, &z, &vx, &vy, &vz, &ax, &ay, &az, &jx, &jy, &jz })
+			field->resize(n);
+		initialize(s);
+	}
+
+	int n = (int)s.size();
+	double halfDt = 0.5 * dt;
+	double dt2 = dt * dt / 2.0;
+	double dt3 = dt * dt * dt / 6.0;
+
+	// predictor, a Taylor series through the jerk
+	#pragma omp parallel for
+	for (int i = 0; i < n; i++) {
+		x[i] = s.px[i];
+		y[i] = s.py[i];
+		z[i] = s.pz[i];
+		vx[i] = s.vx[i];
+		vy[i] = s.vy[i];
+		vz[i] = s.vz[i];
+		ax[i] = s.ax[i];
+		ay[i] = s.ay[i];
+		az[i] = s.az[i];
+		jx[i] = s.jx[i];
+		jy[i] = s.jy[i];
+		jz[i] = s.jz[i];
+
+		s.prevPosition[i] = s.position(i);
+		s.px[i] += vx[i] * dt + ax[i] * dt2 + jx[i] * dt3;
+		s.py[i] += vy[i] * dt + ay[i] * dt2 + jy[i] * dt3;
+		s.pz[i] += vz[i] * dt + az[i] * dt2 + jz[i] * dt3;
+		s.vx[i] += ax[i] * dt + jx[i] * dt2;
+		s.vy[i] += ay[i] * dt + jy[i] * dt2;
+		s.vz[i] += az[i] * dt + jz[i] * dt2;
+
+		// rotation follows the same half-kicks as the leapfrog
+		s.angularMomentum[i] += s.torque[i] * halfDt;
+	}
+	rotateBodies(s, dt);
+
+	s.clearForces();
+	directForces(s, true);
+
+	// corrector, velocities first since the position update uses the corrected velocity
+	double dt12 = dt * dt / 12.0;
+	#pragma omp parallel for
+	for (int i = 0; i < n; i++) {
+		s.vx[i] = vx[i] + (ax[i] + s.ax[i]) * halfDt + (jx[i] - s.jx[i]) * dt12;
+		s.vy[i] = vy[i] + (ay[i] + s.ay[i]) * halfDt + (jy[i] - s.jy[i]) * dt12;
+		s.vz[i] = vz[i] + (az[i] + s.az[i]) * halfDt + (jz[i] - s.jz[i]) * dt12;
+		s.px[i] = x[i] + (vx[i] + s.vx[i]) * halfDt + (ax[i] - s.ax[i]) * dt12;
+		s.py[i] = y[i] + (vy[i] + s.vy[i]) * halfDt + (ay[i] - s.ay[i]) * dt12;
+		s.pz[i] = z[i] + (vz[i] + s.vz[i]) * halfDt + (az[i] - s.az[i]) * dt12;
+
+		s.torque[i] = glm::dvec3(s.tx[i], s.ty[i], s.tz[i]);
+		s.angularMomentum[i] += s.torque[i] * halfDt;
+	}
+}
\ No newline at end of file
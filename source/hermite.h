@@ -0,0 +1,18 @@
+#pragma once
+
+#include "forces.h"
+
+// fourth-order Hermite predictor-corrector (Makino & Aarseth 1992)
+// positions and velocities are predicted from the acceleration and jerk at the start of the step, the forces
+// and jerks are evaluated once at the predicted state, and the corrector fits a cubic through both ends
+// jerks come from the point-mass pair kernel, so forces are always summed directly whatever the selected engine
+class HermiteIntegrator {
+public:
+	void step(BodyStore& s, double dt);
+	void reset() { initialized = false; }
+private:
+	bool initialized = false;
+	std::vector<double> x, y, z, vx, vy, vz, ax, ay, az, jx, jy, jz;	// state at the start of the step
+
+	void initialize(BodyStore& s);
+};
\ No newline at end of file
@@ -29,6 +29,11 @@ Model::Model(
 	std::vector<GLfloat>& normals, std::vector<GLfloat>& tex,
 	std::vector<GLfloat>& tan, std::vector<GLfloat>& bitan
 ) {
+	// without a GL context only the face count is kept
+	if (headless) {
+		numFaces = (GLsizei)indices.size();
+		return;
+	}
 
 	glGenVertexArrays(1, &VAO);
 	glGenBuffers(1, &VBO);
@@ -88,6 +93,11 @@ Model::Model(
 	std::vector<GLfloat>& verts, std::vector<GLuint>& indices,
 	std::vector<GLfloat>& normals, std::vector<GLfloat>& tex
 ) {
+	// without a GL context only the face count is kept
+	if (headless) {
+		numFaces = (GLsizei)indices.size();
+		return;
+	}
 
 	glGenVertexArrays(1, &VAO);
 	glGenBuffers(1, &VBO);
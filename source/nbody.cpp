@@ -1,6 +1,28 @@
 #include "builder.h"
 #include "render.h"
 #include "controls.h"
+#include "forces.h"
+#include "ensemble.h"
+#include "benchmark.h"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+// batch runs report to a console even where the Windows subsystem started them without one: the console they were
+// launched from, or a new one; output already going to a console or redirected to a file is left where it is
+static void attachConsole() {
+#ifdef _WIN32
+	if (GetConsoleWindow() || GetFileType(GetStdHandle(STD_OUTPUT_HANDLE)) != FILE_TYPE_UNKNOWN)
+		return;
+	if (AttachConsole(ATTACH_PARENT_PROCESS) || AllocConsole()) {
+		FILE* stream;
+		freopen_s(&stream, "CONOUT$", "w", stdout);
+		freopen_s(&stream, "CONOUT$", "w", stderr);
+	}
+#endif
+}
 
 static void MessageCallback(GLenum source,
 	GLenum type,
@@ -46,8 +68,144 @@ static void initSeries() {
 	//initLoggers();
 }
 
-int main() {
+static bool parseIntegrator(const char* name) {
+	for (uint8_t i = 0; i < INTEGRATOR_COUNT; i++) {
+		if (strcmp(name, integratorNames[i]) == 0) {
+			integrator = (integration_method)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool parseEngine(const char* name) {
+	for (uint8_t i = 0; i < ENGINE_COUNT; i++) {
+		if (strcmp(name, engineNames[i]) == 0) {
+			forceEngine = (force_engine)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+// nbody --headless [--steps N] [--time seconds] [--step seconds] [--integrator name] [--engine name] [--collisions] [--relativity] [--no-regularization] [--compensated] [--belt N] [--float-belt N] [--log]
+// runs the scene without a window or GL context and reports the throughput, --belt adds N test particles around the first body
+// and --float-belt N single precision ones
+// nbody --precision-benchmark [...] steps the scene once per precision and compares throughput and energy error
+// nbody --microbench times the force passes and steps at 10 to 10^5 bodies and the rotation, orbit, mesh and trail paths
+// on their own, writing the results to microbench.csv and microbench.json
+// nbody --accuracy [--scene kepler|pythagorean|solar|plummer] [--horizon f] [--budget e] runs the standard scenes under every
+// integrator and force engine and reports wall time against energy and position error as Pareto fronts, with the fastest
+// configuration within the error budget; --horizon scales how long every scene runs, and accuracy.csv keeps every run
+// --monitor N samples energy, momentum and angular momentum every N steps and reports their drift
+// --profile times every phase of the steps and writes the history to profile.csv and profile.json
+// --threads N and --render-threads N set the threads of the physics and of the render-side work; by default the physics
+// takes every hardware thread and the render-side work those left over
+// nbody --ensemble K [--spread sigma] [--seed n] [...] runs K perturbed copies of the scene side by side the same way
+int main(int argc, char** argv) {
+	bool batch = false, logging = false, precision = false, micro = false, accuracy = false;
+	size_t steps = 0, members = 0, belt = 0, floatBelt = 0;
+	double duration = 0.0, horizon = 1.0, budget = ACCURACY_BUDGET;
+	const char* engine = nullptr;
+	const char* scene = nullptr;
+
+	for (int i = 1; i < argc; i++) {
+		bool hasValue = i + 1 < argc;
+		if (strcmp(argv[i], "--headless") == 0)
+			batch = true;
+		else if (strcmp(argv[i], "--log") == 0)
+			logging = true;
+		else if (strcmp(argv[i], "--collisions") == 0)
+			doCollisions = true;
+		else if (strcmp(argv[i], "--relativity") == 0)
+			postNewtonian = true;
+		else if (strcmp(argv[i], "--no-regularization") == 0)
+			doRegularization = false;
+		else if (strcmp(argv[i], "--compensated") == 0)
+			doCompensatedSums = true;
+		else if (strcmp(argv[i], "--precision-benchmark") == 0)
+			batch = precision = true;
+		else if (strcmp(argv[i], "--microbench") == 0)
+			batch = micro = true;
+		else if (strcmp(argv[i], "--accuracy") == 0)
+			batch = accuracy = true;
+		else if (strcmp(argv[i], "--scene") == 0 && hasValue)
+			scene = argv[++i];
+		else if (strcmp(argv[i], "--horizon") == 0 && hasValue)
+			horizon = atof(argv[++i]);
+		else if (strcmp(argv[i], "--budget") == 0 && hasValue)
+			budget = atof(argv[++i]);
+		else if (strcmp(argv[i], "--steps") == 0 && hasValue)
+			steps = strtoull(argv[++i], nullptr, 10);
+		else if (strcmp(argv[i], "--belt") == 0 && hasValue)
+			belt = strtoull(argv[++i], nullptr, 10);
+		else if (strcmp(argv[i], "--profile") == 0)
+			doProfiling = true;
+		else if (strcmp(argv[i], "--monitor") == 0 && hasValue)
+			conservationInterval = strtoull(argv[++i], nullptr, 10);
+		else if (strcmp(argv[i], "--threads") == 0 && hasValue)
+			physicsThreads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--render-threads") == 0 && hasValue)
+			renderThreads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--float-belt") == 0 && hasValue)
+			floatBelt = strtoull(argv[++i], nullptr, 10);
+		else if (strcmp(argv[i], "--time") == 0 && hasValue)
+			duration = atof(argv[++i]);
+		else if (strcmp(argv[i], "--step") == 0 && hasValue)
+			simulationStep = atof(argv[++i]);
+		else if (strcmp(argv[i], "--integrator") == 0 && hasValue) {
+			if (!parseIntegrator(argv[++i]))
+				fprintf(stderr, "unknown integrator %s\n", argv[i]);
+		}
+		else if (strcmp(argv[i], "--engine") == 0 && hasValue)
+			engine = argv[++i];
+		else if (strcmp(argv[i], "--ensemble") == 0 && hasValue) {
+			members = strtoull(argv[++i], nullptr, 10);
+			batch = true;
+		}
+		else if (strcmp(argv[i], "--spread") == 0 && hasValue)
+			ensembleSpread = atof(argv[++i]);
+		else if (strcmp(argv[i], "--seed") == 0 && hasValue)
+			ensembleSeed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+		else
+			fprintf(stderr, "ignoring argument %s\n", argv[i]);
+	}
+
+	if (batch) {
+		attachConsole();
+		headless = true;
+		buildObjects();
+		// scenes pick their own force engine, so the override comes after the build
+		if (engine && !parseEngine(engine))
+			fprintf(stderr, "unknown force engine %s\n", engine);
+		if (belt > 0)
+			GravityBodyBuilder().buildBelt(0, belt, 3.0 * bodies[0]->radius, 6.0 * bodies[0]->radius, 0.02);
+		if (floatBelt > 0)
+			GravityBodyBuilder().buildBelt(0, floatBelt, 3.0 * bodies[0]->radius, 6.0 * bodies[0]->radius, 0.02, true);
+		if (logging)
+			initLoggers();
+
+		if (steps == 0 && duration <= 0.0)
+			steps = 1000;
+		if (micro) {
+			std::vector<MicroResult> results = microBenchmarks();
+			if (writeMicroCSV(MICROBENCH_CSV, results) && writeMicroJSON(MICROBENCH_JSON, results))
+				printf("microbenchmarks written to %s and %s\n", MICROBENCH_CSV, MICROBENCH_JSON);
+		}
+		else if (accuracy)
+			accuracyBenchmark(scene, horizon, budget);
+		else if (precision)
+			precisionBenchmark(steps, duration);
+		else if (members > 0)
+			ensembleLoop(members, steps, duration);
+		else
+			headlessLoop(steps, duration);
+		exit(EXIT_SUCCESS);
+	}
+
 	initSeries();
+	// the render thread runs trail tasks itself while it waits, so the pool only takes threads neither it nor the physics use
+	renderPool.resize(renderThreads > 0 ? renderThreads : spareThreads(threadCount(physicsThreads) + 1));
 
 	// entering work area: split program into physics and rendering threads
 	std::thread physicsThread(physicsLoop);
@@ -63,5 +221,9 @@ int main() {
 }
 
 int WinMain() {
-	main();
+#ifdef _WIN32
+	main(__argc, __argv);
+#else
+	main(0, nullptr);
+#endif
 }
\ No newline at end of file
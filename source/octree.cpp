@@ -0,0 +1,276 @@
+#include "octree.h"
+#include "forcemodel.h"
+
+// one tree per simulation thread; the threads of a force pass share it through a reference
+static thread_local Octree threadTree;
+
+// rebuilds the tree over the current positions
+// theta is capped at 1, above which a cell could be accepted by a body inside it
+void Octree::build(const BodyStore& s, double theta) {
+	uint32_t n = (uint32_t)s.size();
+	theta = std::min(theta, 1.0);
+
+	nodes.clear();
+	order.resize(n);
+	scratch.resize(n);
+	octant.resize(n);
+	for (uint32_t i = 0; i < n; i++)
+		order[i] = i;
+	if (n == 0)
+		return;
+
+	glm::dvec3 lower(DBL_MAX), upper(-DBL_MAX);
+	for (uint32_t i = 0; i < n; i++) {
+		lower = glm::min(lower, s.position(i));
+		upper = glm::max(upper, s.position(i));
+	}
+	glm::dvec3 extent = upper - lower;
+	double halfWidth = 0.5 * std::max(extent.x, std::max(extent.y, extent.z));
+
+	nodes.reserve(2 * n / leafSize + 1);
+	subdivide(s, 0.5 * (lower + upper), halfWidth, 0, n, 0);
+
+	// Salmon-Warren criterion: the offset of the center of mass widens the radius of lopsided cells
+	for (OctreeNode& node : nodes) {
+		double offset = glm::length(node.centerOfMass - node.center);
+		node.openingRadius = theta > 0.0 ? 2.0 * node.halfWidth / theta + offset : DBL_MAX;
+	}
+}
+
+uint32_t Octree::subdivide(const BodyStore& s, glm::dvec3 center, double halfWidth, uint32_t begin, uint32_t end, int depth) {
+	uint32_t index = (uint32_t)nodes.size();
+	nodes.emplace_back();
+	OctreeNode& node = nodes[index];
+	node.center = center;
+	node.halfWidth = halfWidth;
+	node.begin = begin;
+	node.end = end;
+	node.leaf = end - begin <= leafSize || depth >= OCTREE_MAX_DEPTH;
+	std::fill(std::begin(node.children), std::end(node.children), OCTREE_NO_CHILD);
+
+	if (!node.leaf) {
+		// counting sort of the cell's bodies by octant
+		uint32_t counts[8] = {};
+		for (uint32_t k = begin; k < end; k++) {
+			glm::dvec3 position = s.position(order[k]);
+			octant[k] = (position.x >= center.x) | (position.y >= center.y) << 1 | (position.z >= center.z) << 2;
+			counts[octant[k]]++;
+		}
+
+		uint32_t offsets[8], cursor[8];
+		offsets[0] = cursor[0] = begin;
+		for (int o = 1; o < 8; o++)
+			offsets[o] = cursor[o] = offsets[o - 1] + counts[o - 1];
+
+		for (uint32_t k = begin; k < end; k++)
+			scratch[cursor[octant[k]]++] = order[k];
+		std::copy(scratch.begin() + begin, scratch.begin() + end, order.begin() + begin);
+
+		for (int o = 0; o < 8; o++) {
+			if (counts[o] == 0)
+				continue;
+			glm::dvec3 offset(o & 1 ? 1.0 : -1.0, o & 2 ? 1.0 : -1.0, o & 4 ? 1.0 : -1.0);
+			uint32_t child = subdivide(s, center + 0.5 * halfWidth * offset, 0.5 * halfWidth,
+				offsets[o], offsets[o] + counts[o], depth + 1);
+			// the recursion may have reallocated the node list
+			nodes[index].children[o] = child;
+		}
+	}
+
+	computeMoments(s, nodes[index]);
+	return index;
+}
+
+// mass, center of mass and quadrupole of a cell, from its bodies or from its children's moments
+void Octree::computeMoments(const BodyStore& s, OctreeNode& node) {
+	double mass = 0.0;
+	glm::dvec3 weighted(0.0);
+	double q[6] = {};
+
+	auto addQuadrupole = [&q](double m, const glm::dvec3& d) {
+		double d2 = glm::dot(d, d);
+		q[0] += m * (3.0 * d.x * d.x - d2);
+		q[1] += m * 3.0 * d.x * d.y;
+		q[2] += m * 3.0 * d.x * d.z;
+		q[3] += m * (3.0 * d.y * d.y - d2);
+		q[4] += m * 3.0 * d.y * d.z;
+		q[5] += m * (3.0 * d.z * d.z - d2);
+	};
+
+	if (node.leaf) {
+		for (uint32_t k = node.begin; k < node.end; k++) {
+			mass += s.mass[order[k]];
+			weighted += s.mass[order[k]] * s.position(order[k]);
+		}
+		node.mass = mass;
+		node.centerOfMass = mass > 0.0 ? weighted / mass : node.center;
+
+		for (uint32_t k = node.begin; k < node.end; k++)
+			addQuadrupole(s.mass[order[k]], s.position(order[k]) - node.centerOfMass);
+	}
+	else {
+		for (uint32_t child : node.children) {
+			if (child == OCTREE_NO_CHILD)
+				continue;
+			mass += nodes[child].mass;
+			weighted += nodes[child].mass * nodes[child].centerOfMass;
+		}
+		node.mass = mass;
+		node.centerOfMass = mass > 0.0 ? weighted / mass : node.center;
+
+		// parallel axis theorem
+		for (uint32_t child : node.children) {
+			if (child == OCTREE_NO_CHILD)
+				continue;
+			const OctreeNode& c = nodes[child];
+			for (int k = 0; k < 6; k++)
+				q[k] += c.quadrupole[k];
+			addQuadrupole(c.mass, c.centerOfMass - node.centerOfMass);
+		}
+	}
+
+	std::copy(std::begin(q), std::end(q), node.quadrupole);
+}
+
+// walks the tree from the root, expanding accepted cells to quadrupole order and
+// handing the bodies of opened leaves to the pair routine of the model
+template <class Model>
+void Octree::forcesOn(const BodyStore& s, size_t target, ForceTarget out) const {
+	if (nodes.empty())
+		return;
+
+	glm::dvec3 position = s.position(target);
+	bool oblate = Model::template has<OblateTorque> && s.gravityType[target] == OBLATE_SPHERE;
+	glm::dvec3 acceleration(0.0), torque(0.0);
+
+	// every level pushes at most eight cells and pops one
+	uint32_t stack[8 * (OCTREE_MAX_DEPTH + 1)];
+	int top = 0;
+	stack[top++] = 0;
+
+	while (top > 0) {
+		const OctreeNode& node = nodes[stack[--top]];
+		if (node.mass == 0.0)
+			continue;
+
+		glm::dvec3 r = position - node.centerOfMass;
+		double r2 = glm::dot(r, r);
+
+		if (r2 > node.openingRadius * node.openingRadius) {
+			double inv2 = 1.0 / r2;
+			double inv3 = inv2 * sqrt(inv2);
+			double inv5 = inv3 * inv2;
+			const double* q = node.quadrupole;
+			glm::dvec3 qr(
+				q[0] * r.x + q[1] * r.y + q[2] * r.z,
+				q[1] * r.x + q[3] * r.y + q[4] * r.z,
+				q[2] * r.x + q[4] * r.y + q[5] * r.z);
+			double rqr = glm::dot(r, qr);
+
+			acceleration += G * (-node.mass * inv3 * r + inv5 * qr - 2.5 * rqr * inv5 * inv2 * r);
+			if (oblate)
+				torque += oblateTorque(s, target, node.centerOfMass, node.mass);
+		}
+		else if (node.leaf) {
+			for (uint32_t k = node.begin; k < node.end; k++) {
+				if (order[k] != target)
+					Model::pull(s, target, order[k], out);
+			}
+		}
+		else {
+			for (uint32_t child : node.children) {
+				if (child != OCTREE_NO_CHILD)
+					stack[top++] = child;
+			}
+		}
+	}
+
+	out.addAcceleration(target, acceleration);
+	out.addTorque(target, torque);
+}
+
+// gravitational potential per unit mass at a body from every other, with the accepted cells as monopole and quadrupole
+double Octree::potentialAt(const BodyStore& s, size_t target) const {
+	if (nodes.empty())
+		return 0.0;
+
+	glm::dvec3 position = s.position(target);
+	double potential = 0.0;
+
+	uint32_t stack[8 * (OCTREE_MAX_DEPTH + 1)];
+	int top = 0;
+	stack[top++] = 0;
+
+	while (top > 0) {
+		const OctreeNode& node = nodes[stack[--top]];
+		if (node.mass == 0.0)
+			continue;
+
+		glm::dvec3 r = position - node.centerOfMass;
+		double r2 = glm::dot(r, r);
+
+		if (r2 > node.openingRadius * node.openingRadius) {
+			double inv2 = 1.0 / r2;
+			double inv1 = sqrt(inv2);
+			const double* q = node.quadrupole;
+			double rqr = q[0] * r.x * r.x + q[3] * r.y * r.y + q[5] * r.z * r.z
+				+ 2.0 * (q[1] * r.x * r.y + q[2] * r.x * r.z + q[4] * r.y * r.z);
+			potential -= G * (node.mass * inv1 + 0.5 * rqr * inv2 * inv2 * inv1);
+		}
+		else if (node.leaf) {
+			for (uint32_t k = node.begin; k < node.end; k++) {
+				uint32_t source = order[k];
+				if (source != target)
+					potential -= G * s.mass[source] / glm::distance(position, s.position(source));
+			}
+		}
+		else {
+			for (uint32_t child : node.children) {
+				if (child != OCTREE_NO_CHILD)
+					stack[top++] = child;
+			}
+		}
+	}
+	return potential;
+}
+
+// total potential energy, half the energy of every body in the field of the others,
+// with the same approximation as the force pass at the same opening angle
+double treePotential(const BodyStore& s, double theta) {
+	Octree& tree = threadTree;
+	tree.build(s, theta);
+
+	double total = 0.0;
+	#pragma omp parallel for schedule(dynamic, 64) reduction(+:total)
+	for (int i = 0; i < (int)s.size(); i++)
+		total += 0.5 * s.mass[i] * tree.potentialAt(s, i);
+	return total;
+}
+
+// Barnes-Hut force pass: O(N log N) in the number of bodies
+// each body walks the tree on its own and only writes its own accumulators
+void treeForces(BodyStore& s, double theta) {
+	Octree& tree = threadTree;
+	tree.build(s, theta);
+
+	ForceTarget out(s);
+	withForceModel(s, true, false, [&](auto model) {
+		// walking in tree order keeps neighbouring targets, and the cells they open, close in cache
+		#pragma omp parallel for schedule(dynamic, 64)
+		for (int k = 0; k < (int)tree.order.size(); k++)
+			tree.forcesOn<decltype(model)>(s, tree.order[k], out);
+	});
+}
+
+// walks the tree only for a subset of targets, every body still acts as a source
+void treeForces(BodyStore& s, double theta, const std::vector<uint32_t>& active) {
+	Octree& tree = threadTree;
+	tree.build(s, theta);
+
+	ForceTarget out(s);
+	withForceModel(s, true, false, [&](auto model) {
+		#pragma omp parallel for schedule(dynamic, 16)
+		for (int k = 0; k < (int)active.size(); k++)
+			tree.forcesOn<decltype(model)>(s, active[k], out);
+	});
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "forces.h"
+
+// bodies per leaf before a cell is subdivided
+const size_t OCTREE_LEAF_SIZE = 8;
+// subdivision stops here so coincident bodies end up sharing a leaf
+const int OCTREE_MAX_DEPTH = 32;
+const uint32_t OCTREE_NO_CHILD = UINT32_MAX;
+
+struct OctreeNode {
+	glm::dvec3 center;			// geometric center of the cell
+	double halfWidth;
+	glm::dvec3 centerOfMass;
+	double mass;
+	double quadrupole[6];		// traceless quadrupole about the center of mass: xx, xy, xz, yy, yz, zz
+	double openingRadius;		// targets further than this from the center of mass see the cell as a multipole
+	uint32_t children[8];
+	uint32_t begin, end;		// range of Octree::order holding the bodies of the cell
+	bool leaf;
+};
+
+class Octree {
+public:
+	std::vector<OctreeNode> nodes;
+	std::vector<uint32_t> order;	// body indices, grouped so that every cell owns a contiguous range
+	size_t leafSize = OCTREE_LEAF_SIZE;
+
+	void build(const BodyStore& s, double theta);
+	template <class Model>
+	void forcesOn(const BodyStore& s, size_t target, ForceTarget out) const;
+	double potentialAt(const BodyStore& s, size_t target) const;
+private:
+	std::vector<uint32_t> scratch;
+	std::vector<uint8_t> octant;
+
+	uint32_t subdivide(const BodyStore& s, glm::dvec3 center, double halfWidth, uint32_t begin, uint32_t end, int depth);
+	void computeMoments(const BodyStore& s, OctreeNode& node);
+};
+
+void treeForces(BodyStore& s, double theta);
+void treeForces(BodyStore& s, double theta, const std::vector<uint32_t>& active);
+double treePotential(const BodyStore& s, double theta);
\ No newline at end of file
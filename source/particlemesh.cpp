@@ -0,0 +1,357 @@
+#include "particlemesh.h"
+#include "forcemodel.h"
+
+int meshSize = 64;
+mesh_assignment meshAssignment = TRIANGULAR_SHAPED_CLOUD;
+bool shortRangeCorrection = false;
+
+static thread_local ParticleMesh mesh;
+
+// first node of the three-node stencil of mesh coordinate x, and the weight of each node
+static int assignmentWeights(mesh_assignment assignment, double x, double* w) {
+	if (assignment == CLOUD_IN_CELL) {
+		int first = (int)floor(x);
+		double f = x - first;
+		w[0] = 1.0 - f;
+		w[1] = f;
+		w[2] = 0.0;
+		return first;
+	}
+
+	int center = (int)floor(x + 0.5);
+	double d = x - center;
+	w[0] = 0.5 * (0.5 - d) * (0.5 - d);
+	w[1] = 0.75 - d * d;
+	w[2] = 0.5 * (0.5 + d) * (0.5 + d);
+	return center - 1;
+}
+
+// rebuilds the FFT tables and the transformed Green's function when the mesh size or the force split changes
+// the Green's function is stored in units of one cell and scaled by the actual spacing at every solve
+void ParticleMesh::configure(int size, bool correction) {
+	if (size == this->size && correction == this->correction)
+		return;
+	this->size = size;
+	this->correction = correction;
+
+	size_t n = 2 * (size_t)size;
+	int bits = 0;
+	while (((size_t)1 << bits) < n)
+		bits++;
+	reversed.resize(n);
+	for (size_t i = 0; i < n; i++) {
+		uint32_t r = 0;
+		for (int b = 0; b < bits; b++)
+			r |= ((i >> b) & 1) << (bits - 1 - b);
+		reversed[i] = r;
+	}
+	twiddles.resize(n / 2);
+	for (size_t k = 0; k < n / 2; k++)
+		twiddles[k] = std::polar(1.0, -2.0 * pi * k / n);
+
+	// long-range part of -1 / r under P3M: -erf(r / 2 r_s) / r, which is finite at the origin
+	// without the split the self term is arbitrary, as the symmetric difference cancels it
+	green.assign(n * n * n, 0.0);
+	#pragma omp parallel for
+	for (int z = 0; z < (int)n; z++) {
+		double dz = z <= size ? z : (double)n - z;
+		for (size_t y = 0; y < n; y++) {
+			double dy = y <= (size_t)size ? y : (double)n - y;
+			for (size_t x = 0; x < n; x++) {
+				double dx = x <= (size_t)size ? x : (double)n - x;
+				double r = sqrt(dx * dx + dy * dy + dz * dz);
+				double value;
+				if (correction)
+					value = r > 0.0 ? erf(r / (2.0 * PM_SPLIT_SCALE)) / r : 1.0 / (sqrt(pi) * PM_SPLIT_SCALE);
+				else
+					value = r > 0.0 ? 1.0 / r : 1.0;
+				green[((size_t)z * n + y) * n + x] = -value;
+			}
+		}
+	}
+	transform(green, false);
+}
+
+// iterative radix-2 transform of one line in place, the inverse is left unnormalized
+void ParticleMesh::transformLine(std::complex<double>* line, bool inverse) const {
+	size_t n = reversed.size();
+	for (size_t i = 0; i < n; i++) {
+		if (i < reversed[i])
+			std::swap(line[i], line[reversed[i]]);
+	}
+
+	for (size_t length = 2; length <= n; length <<= 1) {
+		size_t half = length / 2;
+		size_t step = n / length;
+		for (size_t i = 0; i < n; i += length) {
+			for (size_t k = 0; k < half; k++) {
+				std::complex<double> w = inverse ? std::conj(twiddles[k * step]) : twiddles[k * step];
+				std::complex<double> u = line[i + k];
+				std::complex<double> v = line[i + k + half] * w;
+				line[i + k] = u + v;
+				line[i + k + half] = u - v;
+			}
+		}
+	}
+}
+
+// 3D transform of the padded mesh, one axis at a time with the lines of each axis split between threads
+void ParticleMesh::transform(std::vector<std::complex<double>>& data, bool inverse) {
+	size_t n = reversed.size();
+	for (int axis = 0; axis < 3; axis++) {
+		size_t stride = axis == 0 ? 1 : axis == 1 ? n : n * n;
+
+		#pragma omp parallel
+		{
+			std::vector<std::complex<double>> line(n);
+
+			#pragma omp for schedule(static)
+			for (int l = 0; l < (int)(n * n); l++) {
+				size_t a = l % n, b = l / n;
+				size_t base = axis == 0 ? (b * n + a) * n : axis == 1 ? b * n * n + a : b * n + a;
+				for (size_t i = 0; i < n; i++)
+					line[i] = data[base + i * stride];
+				transformLine(line.data(), inverse);
+				for (size_t i = 0; i < n; i++)
+					data[base + i * stride] = line[i];
+			}
+		}
+	}
+}
+
+// deposits the mass of every body into per-thread meshes, then sums them into the padded grid
+void ParticleMesh::assign(const BodyStore& s, mesh_assignment assignment) {
+	size_t nodes = (size_t)size * size * size;
+	if (density.size() < (size_t)omp_get_max_threads())
+		density.resize(omp_get_max_threads());
+	int threadCount = 1;
+
+	#pragma omp parallel
+	{
+		#pragma omp single
+		threadCount = omp_get_num_threads();
+
+		std::vector<double>& local = density[omp_get_thread_num()];
+		local.assign(nodes, 0.0);
+
+		#pragma omp for schedule(static)
+		for (int i = 0; i < (int)s.size(); i++) {
+			glm::dvec3 x = (s.position(i) - origin) / spacing;
+			double wx[3], wy[3], wz[3];
+			int fx = assignmentWeights(assignment, x.x, wx);
+			int fy = assignmentWeights(assignment, x.y, wy);
+			int fz = assignmentWeights(assignment, x.z, wz);
+
+			for (int c = 0; c < 3; c++) {
+				for (int b = 0; b < 3; b++) {
+					double weight = s.mass[i] * wz[c] * wy[b];
+					for (int a = 0; a < 3; a++)
+						local[node(fx + a, fy + b, fz + c)] += weight * wx[a];
+				}
+			}
+		}
+	}
+
+	size_t n = 2 * (size_t)size;
+	grid.assign(n * n * n, 0.0);
+	#pragma omp parallel for
+	for (int z = 0; z < size; z++) {
+		for (int y = 0; y < size; y++) {
+			for (int x = 0; x < size; x++) {
+				double sum = 0.0;
+				for (int t = 0; t < threadCount; t++)
+					sum += density[t][node(x, y, z)];
+				grid[((size_t)z * n + y) * n + x] = sum;
+			}
+		}
+	}
+}
+
+// convolves the density with the Green's function, then differences the potential into a field per axis
+void ParticleMesh::solve() {
+	size_t n = 2 * (size_t)size;
+	transform(grid, false);
+	#pragma omp parallel for
+	for (int i = 0; i < (int)grid.size(); i++)
+		grid[i] *= green[i];
+	transform(grid, true);
+
+	size_t nodes = (size_t)size * size * size;
+	double scale = G / (spacing * (double)(n * n * n));
+	potential.resize(nodes);
+	#pragma omp parallel for
+	for (int z = 0; z < size; z++) {
+		for (int y = 0; y < size; y++) {
+			for (int x = 0; x < size; x++)
+				potential[node(x, y, z)] = scale * grid[((size_t)z * n + y) * n + x].real();
+		}
+	}
+
+	// fourth-order central difference, left at zero on the two outer layers the stencils never reach
+	for (std::vector<double>& axis : field)
+		axis.assign(nodes, 0.0);
+	double inverse = 1.0 / (12.0 * spacing);
+	#pragma omp parallel for
+	for (int z = 2; z < size - 2; z++) {
+		for (int y = 2; y < size - 2; y++) {
+			for (int x = 2; x < size - 2; x++) {
+				size_t i = node(x, y, z);
+				size_t stride[3] = { 1, (size_t)size, (size_t)size * size };
+				for (int axis = 0; axis < 3; axis++) {
+					size_t d = stride[axis];
+					field[axis][i] = -inverse * (potential[i - 2 * d] - 8.0 * potential[i - d]
+						+ 8.0 * potential[i + d] - potential[i + 2 * d]);
+				}
+			}
+		}
+	}
+}
+
+void ParticleMesh::interpolate(BodyStore& s, mesh_assignment assignment) const {
+	#pragma omp parallel for schedule(static)
+	for (int i = 0; i < (int)s.size(); i++) {
+		glm::dvec3 x = (s.position(i) - origin) / spacing;
+		double wx[3], wy[3], wz[3];
+		int fx = assignmentWeights(assignment, x.x, wx);
+		int fy = assignmentWeights(assignment, x.y, wy);
+		int fz = assignmentWeights(assignment, x.z, wz);
+
+		glm::dvec3 acceleration(0.0);
+		for (int c = 0; c < 3; c++) {
+			for (int b = 0; b < 3; b++) {
+				for (int a = 0; a < 3; a++) {
+					size_t j = node(fx + a, fy + b, fz + c);
+					double weight = wx[a] * wy[b] * wz[c];
+					acceleration += weight * glm::dvec3(field[0][j], field[1][j], field[2][j]);
+				}
+			}
+		}
+
+		s.ax[i] += acceleration.x;
+		s.ay[i] += acceleration.y;
+		s.az[i] += acceleration.z;
+	}
+}
+
+// P3M correction: pairs inside the cutoff go through the pair routine of the model, less the long-range
+// part the mesh already applied, G m (erf(u) - 2u / sqrt(pi) exp(-u^2)) / r^2 with u = r / 2 r_s
+template <class Model>
+void ParticleMesh::shortRange(BodyStore& s, const glm::dvec3& lower, double extent) {
+	double splitScale = PM_SPLIT_SCALE * spacing;
+	double cutoff = PM_CUTOFF * spacing;
+	int cells = std::max(1, std::min(PM_MAX_CELL_LIST, (int)ceil(extent / cutoff)));
+	double cellSize = std::max(cutoff, extent / cells);
+
+	auto cellOf = [&](size_t i) {
+		glm::dvec3 c = (s.position(i) - lower) / cellSize;
+		return glm::ivec3(
+			std::min(cells - 1, (int)c.x),
+			std::min(cells - 1, (int)c.y),
+			std::min(cells - 1, (int)c.z));
+	};
+	auto cellIndex = [cells](const glm::ivec3& c) {
+		return ((size_t)c.z * cells + c.y) * cells + c.x;
+	};
+
+	// counting sort of the bodies into the cell list
+	size_t n = s.size();
+	cellStart.assign((size_t)cells * cells * cells + 1, 0);
+	cellBodies.resize(n);
+	for (size_t i = 0; i < n; i++)
+		cellStart[cellIndex(cellOf(i)) + 1]++;
+	for (size_t c = 1; c < cellStart.size(); c++)
+		cellStart[c] += cellStart[c - 1];
+	std::vector<uint32_t> cursor(cellStart.begin(), cellStart.end() - 1);
+	for (size_t i = 0; i < n; i++)
+		cellBodies[cursor[cellIndex(cellOf(i))]++] = (uint32_t)i;
+
+	ForceTarget out(s);
+	#pragma omp parallel for schedule(dynamic, 64)
+	for (int i = 0; i < (int)n; i++) {
+		glm::ivec3 home = cellOf(i);
+		glm::dvec3 position = s.position(i);
+		glm::dvec3 longRange(0.0);
+
+		for (int z = std::max(0, home.z - 1); z <= std::min(cells - 1, home.z + 1); z++) {
+			for (int y = std::max(0, home.y - 1); y <= std::min(cells - 1, home.y + 1); y++) {
+				for (int x = std::max(0, home.x - 1); x <= std::min(cells - 1, home.x + 1); x++) {
+					size_t c = cellIndex(glm::ivec3(x, y, z));
+					for (uint32_t k = cellStart[c]; k < cellStart[c + 1]; k++) {
+						uint32_t j = cellBodies[k];
+						glm::dvec3 displacement = s.position(j) - position;
+						double r2 = glm::dot(displacement, displacement);
+						if (j == (uint32_t)i || r2 >= cutoff * cutoff)
+							continue;
+
+						Model::pull(s, i, j, out);
+
+						double r = sqrt(r2);
+						double u = r / (2.0 * splitScale);
+						longRange += displacement * (G * s.mass[j] * (erf(u) - 2.0 * u / sqrt(pi) * exp(-u * u)) / (r2 * r));
+					}
+				}
+			}
+		}
+
+		out.addAcceleration(i, -longRange);
+	}
+}
+
+void ParticleMesh::evaluate(BodyStore& s, int size, mesh_assignment assignment, bool correction) {
+	if (s.size() == 0)
+		return;
+	configure(size, correction);
+
+	glm::dvec3 lower(DBL_MAX), upper(-DBL_MAX);
+	for (size_t i = 0; i < s.size(); i++) {
+		lower = glm::min(lower, s.position(i));
+		upper = glm::max(upper, s.position(i));
+	}
+	glm::dvec3 extent = upper - lower;
+	double width = std::max(std::max(extent.x, extent.y), std::max(extent.z, DBL_MIN));
+	spacing = width / (size - 2 * PM_MARGIN);
+	origin = 0.5 * (lower + upper) - 0.5 * (size - 1) * spacing;
+
+	assign(s, assignment);
+	solve();
+	interpolate(s, assignment);
+	if (correction) {
+		withForceModel(s, true, false, [&](auto model) {
+			shortRange<decltype(model)>(s, lower, width);
+		});
+	}
+}
+
+// particle-mesh force pass: the mesh carries point masses, oblate terms are summed exactly on top
+// except for pairs inside the P3M cutoff, which the exact pair routine has already covered
+void meshForces(BodyStore& s, int size, mesh_assignment assignment, bool correction) {
+	mesh.evaluate(s, size, assignment, correction);
+
+	std::vector<size_t> oblate = oblateBodies(s);
+	if (oblate.empty())
+		return;
+
+	double near = correction ? PM_CUTOFF * mesh.cellSpacing() : 0.0;
+
+	ForceTarget out(s);
+	withForceModel(s, false, false, [&](auto model) {
+		using Model = decltype(model);
+		#pragma omp parallel for schedule(dynamic, 64)
+		for (int target = 0; target < (int)s.size(); target++) {
+			if constexpr (Model::template has<OblateField>) {
+				for (size_t body : oblate) {
+					if (body != (size_t)target && glm::length(s.position(body) - s.position(target)) >= near)
+						out.addAcceleration(target, oblateAcceleration(s, body, s.position(target)));
+				}
+			}
+			if constexpr (Model::template has<OblateTorque>) {
+				if (s.gravityType[target] != OBLATE_SPHERE)
+					continue;
+				for (size_t other = 0; other < s.size(); other++) {
+					if (other != (size_t)target && glm::length(s.position(other) - s.position(target)) >= near)
+						out.addTorque(target, oblateTorque(s, target, s.position(other), s.mass[other]));
+				}
+			}
+		}
+	});
+}
\ No newline at end of file
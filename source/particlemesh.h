@@ -0,0 +1,53 @@
+#pragma once
+
+#include <complex>
+#include "forces.h"
+
+enum mesh_assignment : uint8_t {
+	CLOUD_IN_CELL,
+	TRIANGULAR_SHAPED_CLOUD
+};
+
+// P3M splits the force with a Gaussian of this scale, in cells, and drops the short-range part past the cutoff
+const double PM_SPLIT_SCALE = 1.25;
+const double PM_CUTOFF = 4.5 * PM_SPLIT_SCALE;
+// empty cells at each face of the mesh so that assignment and difference stencils stay inside it
+const int PM_MARGIN = 4;
+const int PM_MAX_CELL_LIST = 128;
+
+extern int meshSize;		// nodes per side, a power of two
+extern mesh_assignment meshAssignment;
+extern bool shortRangeCorrection;
+
+// particle-mesh solver: mass is assigned to a cubic mesh fitted around the bodies, the potential comes from a
+// convolution with the Green's function on a mesh padded to twice the size, so the boundaries are isolated
+// rather than periodic, and accelerations are interpolated back with the same assignment kernel
+class ParticleMesh {
+public:
+	void evaluate(BodyStore& s, int size, mesh_assignment assignment, bool correction);
+	double cellSpacing() const { return spacing; }
+private:
+	int size = 0;
+	bool correction = false;
+	glm::dvec3 origin;
+	double spacing = 0.0;
+
+	std::vector<std::complex<double>> green, grid, twiddles;
+	std::vector<uint32_t> reversed;
+	std::vector<std::vector<double>> density;	// per thread
+	std::vector<double> potential, field[3];
+	std::vector<uint32_t> cellStart, cellBodies;
+
+	void configure(int size, bool correction);
+	void transformLine(std::complex<double>* line, bool inverse) const;
+	void transform(std::vector<std::complex<double>>& data, bool inverse);
+	size_t node(int x, int y, int z) const { return ((size_t)z * size + y) * size + x; }
+
+	void assign(const BodyStore& s, mesh_assignment assignment);
+	void solve();
+	void interpolate(BodyStore& s, mesh_assignment assignment) const;
+	template <class Model>
+	void shortRange(BodyStore& s, const glm::dvec3& lower, double extent);
+};
+
+void meshForces(BodyStore& s, int size, mesh_assignment assignment, bool correction);
\ No newline at end of file
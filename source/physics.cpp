@@ -1,8 +1,17 @@
 ﻿#include "physics.h"
 #include "barycenter.h"
 #include "logger.h"
+#include "forces.h"
 
 std::vector<std::unique_ptr<Logger>> loggers;
+static TaskGroup logging;	// logger samples still running from the last publish
+
+int physicsThreads = 0;
+int renderThreads = 0;
+TaskPool physicsPool, renderPool;
+
+Simulation simulation;
+StepProfiler profiler;
 
 uint8_t targetRotation = 0;
 
@@ -10,49 +19,86 @@ Camera camera;
 Camera pipCam;
 
 std::atomic<bool> running(true);
+std::atomic<bool> reloadState(true);
 std::condition_variable physicsDone, physicsStart;
 std::mutex physicsMutex;
 
 bool hasPhysics = false;
 bool doTrails = true;
+bool doCollisions = false;
+bool doRegularization = true;
+bool doCompensatedSums = false;
+bool doProfiling = false;
+size_t conservationInterval = 0;
 
 double frameTime = 0.0;
-double elapsedTime = 0.0;
 double timeStep = 1e5;
+double simulationStep = 100.0;
+double simulationLag = 0.0;
+double droppedTime = 0.0;
+integration_method integrator = LEAPFROG;
 size_t maxTrailLength = 2500;
 
 std::unordered_map<size_t, double> lastTheta;
 
-static void mergeNearBodies() {
-	for (int i = 0; i < bodies.size(); i++) {
-		for (int j = i + 1; j < bodies.size(); j++) {
-			// bodies within a medium distance are merged into one body
-			double minDist = fmax(bodies[i]->radius, bodies[j]->radius) / 5.0;
-			if (glm::distance(bodies[i]->position, bodies[j]->position) < minDist) {
-				std::shared_ptr<GravityBody> a = bodies[i];
-				std::shared_ptr<GravityBody> b = bodies[j];
-
-				// mass relative to the 2-body system
-				double m1 = a->mass / (a->mass + b->mass);
-				double m2 = b->mass / (a->mass + b->mass);
-				
-				// set mass-centered ballistic properties
-				glm::dvec3 center = a->position * m1 + b->position * m2;
-				glm::dvec3 vel = a->velocity * m1 + b->velocity * m2;
-				a->position = center;
-				a->velocity = vel;
-				a->mass += b->mass;
-
-				// resize volume
-				double r1 = a->radius;
-				double r2 = b->radius;
-				a->radius = cbrt(r1 * r1 * r1 + r2 * r2 * r2);
-				a->scale = glm::dvec3(a->radius);
-				bodies.erase(bodies.begin() + j);
-				j--;
-			}
+static void remapIndex(size_t& index, const std::vector<size_t>& remap) {
+	if (index < remap.size())
+		index = remap[index];
+}
+
+// drops the bodies absorbed by the last merge pass from the context, and points every index held by
+// the bodies, their trails and barycenters, the cameras and the loggers at the body now holding what it pointed at
+// the lists change length, so this holds physicsMutex, under which the render thread reads them
+static void removeMergedBodies(const Collisions& merged) {
+	std::lock_guard<std::mutex> lock(physicsMutex);
+	std::vector<Barycenter*> barycenters;
+	context remaining;
+	for (size_t i = 0; i < bodies.size() && i < merged.absorbed.size(); i++) {
+		std::shared_ptr<GravityBody> body = bodies[i];
+		if (merged.absorbed[i]) {
+			std::erase_if(entities, [&](const std::shared_ptr<Entity>& entity) { return entity->root == body; });
+			continue;
+		}
+
+		if (body->parentIndex < merged.remap.size()) {
+			body->parentIndex = merged.remap[body->parentIndex];
+			if (body->parentIndex == remaining.size())
+				body->parentIndex = -1;
 		}
+		if (body->trail && body->trail->parentIndex < merged.remap.size())
+			body->trail->parentIndex = merged.remap[body->trail->parentIndex];
+		if (body->barycenter && std::find(barycenters.begin(), barycenters.end(), body->barycenter) == barycenters.end())
+			barycenters.push_back(body->barycenter);
+		remaining.push_back(body);
+	}
+
+	for (Barycenter* barycenter : barycenters)
+		barycenter->remap(merged.remap);
+
+	for (Camera* eye : { &camera, &pipCam }) {
+		remapIndex(eye->eyeIndex, merged.remap);
+		remapIndex(eye->atIndex, merged.remap);
+	}
+
+	// orbit angles of absorbed bodies go with them
+	std::unordered_map<size_t, double> angles;
+	for (const auto& [index, theta] : lastTheta) {
+		if (index < merged.absorbed.size() && !merged.absorbed[index])
+			angles[merged.remap[index]] = theta;
+	}
+	lastTheta = std::move(angles);
+
+	// merged bodies grow, and their models with them
+	for (size_t i = 0; i < remaining.size(); i++) {
+		GravityBody& body = *remaining[i];
+		double radius = simulation.state.radius[i];
+		if (body.radius > 0.0)
+			body.scale *= radius / body.radius;
+		body.radius = radius;
+		body.momentOfInertia = simulation.state.momentOfInertia[i];
 	}
+
+	bodies = remaining;
 }
 
 static bool absoluteOrbitalAngle(size_t index) {
@@ -149,82 +195,7 @@ static double semiMajorAxis(size_t parent, size_t orbiter) {
 	return 1.0 / (2.0 / distance - speed * speed / (G * bodies[parent]->mass));
 }
 
-static void gravitationalForce(std::shared_ptr<GravityBody>& a, std::shared_ptr<GravityBody>& b) {
-	glm::dvec3 displacement = b->position - a->position;
-	double distance = glm::length(displacement);
-	glm::dvec3 direction = glm::normalize(displacement);
-	glm::dvec3 fieldLine = (G * direction) / (distance * distance);
-	glm::dvec3 accelerationA = b->mass * fieldLine;
-
-	if (b->gravityType == OBLATE_SPHERE) {
-		// oblate perturbations on a by b, using MacCullagh's formula
-		glm::dvec3 axisOfRotation = glm::normalize(b->rotQuat * glm::dvec3(0.0, 1.0, 0.0));
-		double cosTheta = glm::dot(-direction, axisOfRotation);
-		double sin2Theta = 1 - cosTheta * cosTheta;
-		double radiusOverDistance = b->radius / distance;
-		accelerationA *= 1 - 3.0 * b->j2 * radiusOverDistance * radiusOverDistance * (3.0 * sin2Theta - 1.0);
-
-		// torque
-		b->nextTorque += 3.0 * G * a->mass * b->mass * b->j2 * radiusOverDistance * radiusOverDistance / distance
-			* cosTheta * glm::cross(-direction, axisOfRotation);
-	}
-
-	glm::dvec3 accelerationB = -a->mass * fieldLine;
-
-	if (a->gravityType == OBLATE_SPHERE) {
-		// oblate perturbations on b by a, using MacCullagh's formula
-		glm::dvec3 axisOfRotation = glm::normalize(a->rotQuat * glm::dvec3(0.0, 1.0, 0.0));
-		double cosTheta = glm::dot(direction, axisOfRotation);
-		double sin2Theta = 1 - cosTheta * cosTheta;
-		double radiusOverDistance = a->radius / distance;
-		accelerationB *= 1 - 3.0 * a->j2 * radiusOverDistance * radiusOverDistance * (3.0 * sin2Theta - 1.0);
-
-		// torque
-		a->nextTorque += 3.0 * G * a->mass * b->mass * a->j2 * radiusOverDistance * radiusOverDistance / distance
-			* cosTheta * glm::cross(direction, axisOfRotation);
-	}
-
-	a->acceleration += accelerationA;
-	b->acceleration += accelerationB;
-}
-
-static void updateBodies(context& bodies, double deltaTime) {
-	double fullDt = timeStep * deltaTime;
-	double halfDt = fullDt * 0.5;
-
-	// Update velocities and positions by half-step, clear accelerations
-	#pragma omp parallel for
-	for (std::shared_ptr<GravityBody>& body : bodies) {
-		body->velocity += body->acceleration * halfDt;
-
-		body->prevPosition = body->position;
-		body->position += body->velocity * fullDt;
-
-		body->torque = body->nextTorque;
-		body->angularMomentum += body->torque * halfDt;
-
-		body->rotateRK4(fullDt);
-		
-		body->acceleration = body->nextTorque = glm::dvec3(0.0);
-	}
-
-	// Compute forces between particles
-	for (size_t i = 0; i < bodies.size(); ++i) {
-		for (size_t j = i + 1; j < bodies.size(); ++j)
-			gravitationalForce(bodies[i], bodies[j]);
-	}
-
-	// Update velocities to full-step using the new accelerations
-	#pragma omp parallel for
-	for (std::shared_ptr<GravityBody>& body : bodies) {
-		body->velocity += body->acceleration * halfDt;
-		body->angularMomentum += body->torque * halfDt;
-	}
-
-	elapsedTime += fullDt;
-}
-
-static void tracePath(size_t parent, size_t orbiter) {
+void tracePath(size_t parent, size_t orbiter) {
 	bool doLoop = true;
 
 	glm::dvec3 parentPos;
@@ -271,7 +242,7 @@ static void tracePath(size_t parent, size_t orbiter) {
 }
 
 // draw an orbit around a given mass where the orbiter has a given position and velocity relative to it
-static void drawEllipse(Trail* trail, const glm::dvec3& position, const glm::dvec3& velocity, double parentMass) {
+void drawEllipse(Trail* trail, const glm::dvec3& position, const glm::dvec3& velocity, double parentMass) {
 	double distance = glm::length(position);
 	double speed = glm::length(velocity);
 
@@ -372,8 +343,7 @@ static void ellipticalPath(context& bodies, size_t parent, size_t orbiter) {
 }
 
 void updateTrails(context& bodies) {
-	#pragma omp parallel for
-	for (size_t i = 0; i < bodies.size(); i++) {
+	renderPool.parallelFor(0, (int)bodies.size(), 4, [&](int i) {
 		std::shared_ptr<GravityBody> body = bodies[i];
 		Trail* trail = body->trail;
 
@@ -397,7 +367,68 @@ void updateTrails(context& bodies) {
 					trail->pop();
 			}
 		}
+	});
+}
+
+// the calling thread's OpenMP team and the physics pool share the configured number of threads; the pool only
+// samples the loggers, so it gets a worker only while there are loggers, taken out of the team so the two never
+// oversubscribe; the forces, integrators and engines stay on the team, as every phase of a step waits on the last
+void applyThreadSettings() {
+	size_t threads = threadCount(physicsThreads);
+	size_t workers = loggers.empty() ? 0 : std::min(threads - 1, (size_t)1);
+	omp_set_num_threads((int)(threads - workers));
+	if (physicsPool.size() != workers)
+		physicsPool.resize(workers);
+}
+
+// every logger samples the published bodies on the physics pool, overlapping the steps that follow;
+// the bodies must not change again before waitForLoggers
+static void sampleLoggers(double totalTimeElapsed) {
+	glm::float64 timeStamp = totalTimeElapsed / (31.7791f * 3600.0f);
+	for (std::unique_ptr<Logger>& logger : loggers) {
+		Logger* sampled = logger.get();
+		physicsPool.run(logging, [sampled, timeStamp]() {
+			Clock::time_point start = Clock::now();
+			sampled->logIfNeeded(timeStamp);
+			if (doProfiling)
+				profiler.addAsync(PHASE_LOGGING, std::chrono::duration<double>(Clock::now() - start).count());
+		});
+	}
+}
+
+// relative drifts of the last sample, when the monitor is on
+void printConservation(const ConservationMonitor& monitor) {
+	if (monitor.interval == 0 || !monitor.sampled)
+		return;
+	printf("conservation after %.3g s: energy %.3e, momentum %.3e, angular momentum %.3e%s\n",
+		monitor.time, monitor.energyDrift, monitor.momentumDrift, monitor.angularDrift,
+		monitor.pointMassesOnly ? "" : " (point masses only, the J2 and 1PN terms are left out)");
+}
+
+// force error the FMM solver sampled last, while it is the engine in use
+void printForceError(const FastMultipole& solver) {
+	if (forceEngine != FMM || solver.errorSamples == 0)
+		return;
+	printf("fmm order %d, theta %.2f: relative force error %.2e rms, %.2e max\n",
+		multipoleOrder, openingAngle, solver.errorRms.load(), solver.errorMax.load());
+}
+
+// mean time of every phase over the history, and the files of the whole history
+void printProfile(const std::vector<StepProfile>& history) {
+	if (history.empty())
+		return;
+	StepProfile mean = averageProfile(history);
+	printf("mean of %zu steps: %.3f ms\n", history.size(), mean.total * 1e3);
+	for (int p = 0; p < PHASE_COUNT; p++) {
+		if (mean.phase[p] > 0.0)
+			printf("  %-16s %9.3f ms %6.1f%%\n", phaseNames[p], mean.phase[p] * 1e3, 100.0 * mean.phase[p] / mean.total);
 	}
+	if (writeProfileCSV(PROFILE_CSV, history) && writeProfileJSON(PROFILE_JSON, history))
+		printf("step profile written to %s and %s\n", PROFILE_CSV, PROFILE_JSON);
+}
+
+static void waitForLoggers() {
+	physicsPool.wait(logging);
 }
 
 void initLoggers() {
@@ -409,36 +440,156 @@ void initLoggers() {
 
 void physicsLoop() {
 	double totalTimeElapsed = 0.0;
+	double owed = 0.0;	// simulated time the requested rate has asked for and no step has covered yet
+	size_t reportedSamples = 0;	// force error samples of the FMM solver already printed
+	bool behind = false;
+
+	printf("gravity kernel: %s\n", simdLevelName(simdLevel));
+	applyThreadSettings();
 
 	Clock::time_point lastLoopTime = Clock::now();
 
 	while (running) {
-		Clock::time_point currentTime = Clock::now();
+		if (!hasPhysics) {
+			// thread waits while physics are disabled
+			std::unique_lock<std::mutex> lock(physicsMutex);
+			physicsStart.wait(lock);
+			lastLoopTime = Clock::now();
+			continue;
+		}
+
+		Clock::time_point wakeTime = Clock::now();
 		double deltaTime =
-			std::chrono::duration<double>(currentTime - lastLoopTime).count();
-		lastLoopTime = currentTime;
-
-		frameTime = deltaTime * timeStep;
-		if (frameTime < MAX_PHYSICS_TIME) {
-			if (hasPhysics) {
-				totalTimeElapsed += frameTime;
-				
-				updateBodies(bodies, deltaTime);
-
-				// write astronomical data to file
-				for (std::unique_ptr<Logger>& logger : loggers)
-					logger->logIfNeeded(totalTimeElapsed / (31.7791f * 3600.0f));
-
-				// data is ready for renderer to access
-				physicsDone.notify_one();
-			}
-			else {
-				// thread waits while physics are disabled
-				std::unique_lock<std::mutex> lock(physicsMutex);
-				physicsStart.wait(lock);
+			std::chrono::duration<double>(wakeTime - lastLoopTime).count();
+		lastLoopTime = wakeTime;
+
+		simulation.integrator = integrator;
+		simulation.mergeCollisions = doCollisions;
+		simulation.regularize = doRegularization;
+		simulation.compensated = doCompensatedSums;
+		simulation.monitor.interval = conservationInterval;
+		simulation.profiler = doProfiling ? &profiler : nullptr;
+
+		// the fixed-step integrators are called once per simulationStep, those choosing their own steps once per
+		// chunk of them, so every call covers the same interval whatever the wall clock does
+		size_t chunk = simulation.stepsPerCall();
+		double interval = chunk * simulationStep;
+
+		// a backlog past the limit is given up, but counted and shown rather than lost silently
+		owed += deltaTime * timeStep;
+		double backlog = std::max(MAX_BACKLOG_TIME * timeStep, interval);
+		if (owed > backlog) {
+			droppedTime += owed - backlog;
+			owed = backlog;
+		}
+
+		// steps until the owed time is covered or this wake has used its share of real time
+		double stepped = 0.0;
+		if (owed >= interval) {
+			// bodies edited outside of the physics thread are gathered again before stepping
+			if (reloadState.exchange(false) || simulation.state.size() != bodies.size())
+				simulation.load(bodies);
+
+			do {
+				if (simulation.step(interval, chunk)) {
+					waitForLoggers();
+					removeMergedBodies(simulation.collisions);
+				}
+				owed -= interval;
+				stepped += interval;
+			} while (owed >= interval &&
+				std::chrono::duration<double>(Clock::now() - wakeTime).count() < MAX_WAKE_TIME);
+
+			waitForLoggers();
+			simulation.state.publish(bodies);
+			totalTimeElapsed += stepped;
+
+			// write astronomical data to file while the next wake steps
+			sampleLoggers(totalTimeElapsed);
+
+			if (simulation.multipole.errorSamples != reportedSamples) {
+				reportedSamples = simulation.multipole.errorSamples;
+				printForceError(simulation.multipole);
 			}
 		}
-		else
-			printf("discarded physics frame: %.2f ms\n", deltaTime * 1000);
+		frameTime = stepped;
+
+		// steps still owed after a full wake mean the requested rate is more than the machine can keep up with
+		simulationLag = owed >= interval ? owed : 0.0;
+		if (simulationLag > 0.0 && !behind)
+			printf("physics behind the requested rate: %.3g s of simulated time pending\n", simulationLag);
+		behind = simulationLag > 0.0;
+
+		// data is ready for renderer to access
+		physicsDone.notify_one();
+
+		// ahead of the requested rate, nap until the next step is owed, briefly so the renderer keeps its frames
+		if (owed < interval) {
+			double wait = (interval - owed) / timeStep;
+			std::this_thread::sleep_for(std::chrono::duration<double>(std::min(wait, SCHEDULER_NAP)));
+		}
+	}
+}
+
+// batch run without a window: fixed steps until the step count, or failing that the simulated duration, is covered,
+// as fast as the machine allows, with throughput reported along the way and at the end
+void headlessLoop(size_t steps, double duration) {
+	if (steps == 0)
+		steps = (size_t)ceil(duration / simulationStep);
+
+	applyThreadSettings();
+	printf("gravity kernel: %s, %d threads\n", simdLevelName(simdLevel), omp_get_max_threads());
+	printf("%zu bodies, %zu test particles (%zu single precision), %zu steps of %.3g s\n",
+		bodies.size(), simulation.particles.size() + simulation.floatParticles.size(), simulation.floatParticles.size(),
+		steps, simulationStep);
+
+	simulation.load(bodies);
+	simulation.integrator = integrator;
+	simulation.mergeCollisions = doCollisions;
+	simulation.regularize = doRegularization;
+	simulation.compensated = doCompensatedSums;
+	simulation.monitor.interval = conservationInterval;
+	simulation.profiler = doProfiling ? &profiler : nullptr;
+	std::vector<StepProfile> history, fresh;
+	pairInteractions = 0;
+
+	double totalTimeElapsed = 0.0;
+	Clock::time_point start = Clock::now(), lastReport = start;
+	for (size_t step = 0; step < steps; step++) {
+		if (simulation.step(simulationStep)) {
+			waitForLoggers();
+			removeMergedBodies(simulation.collisions);
+		}
+		totalTimeElapsed += simulationStep;
+		if (doProfiling) {
+			fresh.clear();
+			profiler.drain(fresh);
+			appendProfiles(history, fresh);
+		}
+
+		// loggers read the bodies, which are only brought up to date when someone is listening
+		if (!loggers.empty()) {
+			waitForLoggers();
+			simulation.state.publish(bodies);
+			sampleLoggers(totalTimeElapsed);
+		}
+
+		Clock::time_point now = Clock::now();
+		if (now - lastReport > std::chrono::seconds(HEADLESS_REPORT_INTERVAL)) {
+			double seconds = std::chrono::duration<double>(now - start).count();
+			printf("%zu / %zu steps, %.0f s, %.3g steps/s\n", step + 1, steps, seconds, (step + 1) / seconds);
+			printConservation(simulation.monitor);
+			printForceError(simulation.multipole);
+			lastReport = now;
+		}
 	}
+	waitForLoggers();
+	simulation.state.publish(bodies);
+
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	printf("%.3g s simulated in %.3f s: %.3g steps/s, %.3g pair interactions/s\n",
+		totalTimeElapsed, seconds, steps / seconds, pairInteractions.load() / seconds);
+	printConservation(simulation.monitor);
+	printForceError(simulation.multipole);
+	printProfile(history);
 }
\ No newline at end of file
@@ -5,23 +5,48 @@
 #include <chrono>
 #include "camera.h"
 #include "gravitybody.h"
+#include "simulation.h"
+#include "taskpool.h"
 
 using Clock = std::chrono::high_resolution_clock;
 
 extern Camera camera, pipCam;
-extern std::atomic<bool> running;
+extern std::atomic<bool> running, reloadState;
 extern std::condition_variable physicsDone, physicsStart;
 extern std::mutex physicsMutex;
-extern bool hasPhysics, doTrails;
-extern double elapsedTime, timeStep, frameTime;
+extern bool hasPhysics, doTrails, doCollisions, doRegularization, doCompensatedSums, doProfiling;
+extern Simulation simulation;	// the system the physics thread steps and the renderer shows
+extern StepProfiler profiler;	// phases of its steps while doProfiling is set, drained by the renderer
+extern double timeStep, frameTime;
+extern double simulationStep;	// simulated time of every fixed step, and the unit of the chunks an adaptive integrator is handed
+extern double simulationLag;	// simulated time owed beyond what the last wake could step through
+extern double droppedTime;		// simulated time given up because the backlog outgrew MAX_BACKLOG_TIME
+extern size_t conservationInterval;	// steps between samples of the conservation monitor, 0 for none
+extern integration_method integrator;	// selected in the settings, picked up by the simulation at its next wake
 extern uint8_t targetRotation;
+extern int physicsThreads;		// force passes and physics tasks, 0 for one per hardware thread
+extern int renderThreads;		// trail generation and other render-side work, 0 for those the physics leaves
+extern TaskPool physicsPool, renderPool;
 
-const float MAX_PHYSICS_TIME = 3600.0f;
+// the physics thread steps for at most MAX_WAKE_TIME of real time before handing results to the renderer,
+// naps for at most SCHEDULER_NAP while ahead, and keeps at most MAX_BACKLOG_TIME of real time worth of owed steps
+const double MAX_WAKE_TIME = 0.02;
+const double SCHEDULER_NAP = 0.002;
+const double MAX_BACKLOG_TIME = 1.0;
+// seconds of real time between progress reports of a headless run
+const int HEADLESS_REPORT_INTERVAL = 10;
 
 glm::dvec3 orbitalVelocity(size_t parent, size_t orbiter);
 
 void updateTrails(context& bodies);
+void tracePath(size_t parent, size_t orbiter);
+void drawEllipse(Trail* trail, const glm::dvec3& position, const glm::dvec3& velocity, double parentMass);
 glm::dmat4 relativeRotationalMatrix(context& list, 
 	const std::shared_ptr<GravityBody>& subject, const std::shared_ptr<GravityBody>& reference, bool detranslate = false);
 void initLoggers();
-void physicsLoop();
\ No newline at end of file
+void applyThreadSettings();
+void printConservation(const ConservationMonitor& monitor);
+void printForceError(const FastMultipole& solver);
+void printProfile(const std::vector<StepProfile>& history);
+void physicsLoop();
+void headlessLoop(size_t steps, double duration);
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include "profiler.h"
+#include <fstream>
+
+const char* const phaseNames[PHASE_COUNT] = {
+	"drift", "rotation", "forces", "kick", "regularization", "particles", "merge", "monitor", "logging", "other"
+};
+
+thread_local StepProfiler* activeProfiler = nullptr;
+
+void StepProfiler::beginStep() {
+	current = StepProfile();
+	current.step = steps++;
+	for (int p = 0; p < PHASE_COUNT; p++)
+		current.phase[p] = asyncNanoseconds[p].exchange(0, std::memory_order_relaxed) * 1e-9;
+	stepStart = std::chrono::steady_clock::now();
+}
+
+// the time not claimed by any phase goes to PHASE_OTHER, work on other threads is left out of it
+void StepProfiler::endStep() {
+	current.total = std::chrono::duration<double>(std::chrono::steady_clock::now() - stepStart).count();
+	double claimed = 0.0;
+	for (int p = 0; p < PHASE_COUNT; p++) {
+		if (p != PHASE_LOGGING)
+			claimed += current.phase[p];
+	}
+	current.phase[PHASE_OTHER] = std::max(0.0, current.total - claimed);
+
+	size_t h = head.load(std::memory_order_relaxed);
+	if (h - tail.load(std::memory_order_acquire) == PROFILE_HISTORY) {
+		dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	ring[h % PROFILE_HISTORY] = current;
+	head.store(h + 1, std::memory_order_release);
+}
+
+// from the stepping thread only
+void StepProfiler::add(profile_phase phase, double seconds) {
+	current.phase[phase] += seconds;
+}
+
+// from any thread
+void StepProfiler::addAsync(profile_phase phase, double seconds) {
+	asyncNanoseconds[phase].fetch_add((uint64_t)(seconds * 1e9), std::memory_order_relaxed);
+}
+
+// moves every finished step into out, returns how many; from the single reader only
+size_t StepProfiler::drain(std::vector<StepProfile>& out) {
+	size_t t = tail.load(std::memory_order_relaxed);
+	size_t h = head.load(std::memory_order_acquire);
+	for (size_t k = t; k < h; k++)
+		out.push_back(ring[k % PROFILE_HISTORY]);
+	tail.store(h, std::memory_order_release);
+	return h - t;
+}
+
+PhaseTimer::PhaseTimer(profile_phase phase) : profiler(activeProfiler), phase(phase) {
+	if (profiler && profiler->open[phase]++ == 0)
+		start = std::chrono::steady_clock::now();
+}
+
+PhaseTimer::~PhaseTimer() {
+	if (profiler && --profiler->open[phase] == 0)
+		profiler->add(phase, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
+
+void appendProfiles(std::vector<StepProfile>& history, const std::vector<StepProfile>& fresh) {
+	history.insert(history.end(), fresh.begin(), fresh.end());
+	if (history.size() > PROFILE_KEEP)
+		history.erase(history.begin(), history.end() - PROFILE_KEEP);
+}
+
+// mean of the last steps of the history, all of them by default
+StepProfile averageProfile(const std::vector<StepProfile>& history, size_t last) {
+	StepProfile mean;
+	size_t count = std::min(last, history.size());
+	if (count == 0)
+		return mean;
+	for (size_t k = history.size() - count; k < history.size(); k++) {
+		mean.total += history[k].total;
+		for (int p = 0; p < PHASE_COUNT; p++)
+			mean.phase[p] += history[k].phase[p];
+	}
+	mean.total /= count;
+	for (int p = 0; p < PHASE_COUNT; p++)
+		mean.phase[p] /= count;
+	mean.step = history.back().step;
+	return mean;
+}
+
+// one row per step, seconds in every column
+bool writeProfileCSV(const std::filesystem::path& path, const std::vector<StepProfile>& history) {
+	std::ofstream out(path);
+	if (!out)
+		return false;
+
+	out << "step,total";
+	for (const char* name : phaseNames)
+		out << ',' << name;
+	out << '\n';
+	for (const StepProfile& profile : history) {
+		out << profile.step << ',' << profile.total;
+		for (double seconds : profile.phase)
+			out << ',' << seconds;
+		out << '\n';
+	}
+	return true;
+}
+
+// {"phases": [...], "steps": [{"step": n, "total": s, "phases": [s, ...]}, ...]}
+bool writeProfileJSON(const std::filesystem::path& path, const std::vector<StepProfile>& history) {
+	std::ofstream out(path);
+	if (!out)
+		return false;
+
+	out << "{\n\"phases\": [";
+	for (int p = 0; p < PHASE_COUNT; p++)
+		out << (p ? ", " : "") << '"' << phaseNames[p] << '"';
+	out << "],\n\"steps\": [\n";
+	for (size_t k = 0; k < history.size(); k++) {
+		const StepProfile& profile = history[k];
+		out << "{\"step\": " << profile.step << ", \"total\": " << profile.total << ", \"phases\": [";
+		for (int p = 0; p < PHASE_COUNT; p++)
+			out << (p ? ", " : "") << profile.phase[p];
+		out << "]}" << (k + 1 < history.size() ? ",\n" : "\n");
+	}
+	out << "]\n}\n";
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+enum profile_phase : uint8_t {
+	PHASE_DRIFT,			// opening half kick and drift of the symplectic substeps
+	PHASE_ROTATION,
+	PHASE_FORCES,			// every force pass, whichever integrator asks for it
+	PHASE_KICK,				// closing half kick
+	PHASE_REGULARIZATION,	// pair selection and Kepler drifts of close pairs
+	PHASE_PARTICLES,
+	PHASE_MERGE,
+	PHASE_MONITOR,
+	PHASE_LOGGING,			// logger samples, which run beside the steps and are counted in the step that follows
+	PHASE_OTHER,			// the rest of the step, mostly the integrators outside the symplectic family
+	PHASE_COUNT
+};
+
+extern const char* const phaseNames[PHASE_COUNT];
+
+// files written by an export of the step history
+const char* const PROFILE_CSV = "profile.csv";
+const char* const PROFILE_JSON = "profile.json";
+
+// steps the physics thread can run ahead of the reader before new ones are dropped
+const size_t PROFILE_HISTORY = 4096;
+
+struct StepProfile {
+	uint64_t step = 0;
+	double total = 0.0;				// seconds of the whole step
+	double phase[PHASE_COUNT] = {};	// seconds of each phase
+};
+
+// per-phase timings of every step, written by the stepping thread into a single-producer single-consumer ring
+// and drained by one reader, the render thread or the end of a headless run; neither side ever blocks
+class StepProfiler {
+public:
+	std::atomic<uint64_t> dropped{ 0 };	// steps lost to a full ring
+
+	void beginStep();
+	void endStep();
+	void add(profile_phase phase, double seconds);
+	void addAsync(profile_phase phase, double seconds);
+	size_t drain(std::vector<StepProfile>& out);
+private:
+	friend class PhaseTimer;
+
+	std::array<StepProfile, PROFILE_HISTORY> ring;
+	std::atomic<size_t> head{ 0 }, tail{ 0 };
+	std::atomic<uint64_t> asyncNanoseconds[PHASE_COUNT] = {};	// from other threads, folded into the next step
+	StepProfile current;
+	std::chrono::steady_clock::time_point stepStart;
+	int open[PHASE_COUNT] = {};		// timers of each phase running on the stepping thread
+	uint64_t steps = 0;
+};
+
+// the profiler of the simulation stepping on this thread, null while none is listening
+extern thread_local StepProfiler* activeProfiler;
+
+// times the enclosing scope into the active profiler; nested timers of the same phase count once
+class PhaseTimer {
+public:
+	explicit PhaseTimer(profile_phase phase);
+	~PhaseTimer();
+private:
+	StepProfiler* profiler;
+	profile_phase phase;
+	std::chrono::steady_clock::time_point start;
+};
+
+// steps kept by a reader for display and export, the oldest are dropped past this
+const size_t PROFILE_KEEP = 100000;
+
+void appendProfiles(std::vector<StepProfile>& history, const std::vector<StepProfile>& fresh);
+StepProfile averageProfile(const std::vector<StepProfile>& history, size_t last = SIZE_MAX);
+bool writeProfileCSV(const std::filesystem::path& path, const std::vector<StepProfile>& history);
+bool writeProfileJSON(const std::filesystem::path& path, const std::vector<StepProfile>& history);
\ No newline at end of file
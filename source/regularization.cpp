@@ -0,0 +1,200 @@
+#include "regularization.h"
+#include "profiler.h"
+#include "wisdomholman.h"
+
+// KS matrix L(u) applied to w, with L(u) u = (x, y, z, 0) and L(u) L(u)^T = |u|^2
+static glm::dvec4 ksMatrix(const glm::dvec4& u, const glm::dvec4& w) {
+	return glm::dvec4(
+		u.x * w.x - u.y * w.y - u.z * w.z + u.w * w.w,
+		u.y * w.x + u.x * w.y - u.w * w.z - u.z * w.w,
+		u.z * w.x + u.w * w.y + u.x * w.z + u.y * w.w,
+		u.w * w.x - u.z * w.y + u.y * w.z - u.x * w.w);
+}
+
+static glm::dvec4 ksTranspose(const glm::dvec4& u, const glm::dvec4& w) {
+	return glm::dvec4(
+		u.x * w.x + u.y * w.y + u.z * w.z + u.w * w.w,
+		-u.y * w.x + u.x * w.y + u.w * w.z - u.z * w.w,
+		-u.z * w.x - u.w * w.y + u.x * w.z + u.y * w.w,
+		u.w * w.x - u.z * w.y + u.y * w.z - u.x * w.w);
+}
+
+// one of the KS vectors of a position, the branch chosen so the division is by the larger root
+static glm::dvec4 toKS(const glm::dvec3& position) {
+	double r = glm::length(position);
+	if (r == 0.0)
+		return glm::dvec4(0.0);
+	if (position.x >= 0.0) {
+		double u1 = sqrt(0.5 * (r + position.x));
+		return glm::dvec4(u1, 0.5 * position.y / u1, 0.5 * position.z / u1, 0.0);
+	}
+	double u2 = sqrt(0.5 * (r - position.x));
+	return glm::dvec4(0.5 * position.y / u2, u2, 0.0, 0.5 * position.z / u2);
+}
+
+// advances a two-body orbit of gravitational parameter gm by dt through the KS transformation, in which the
+// Kepler problem is a harmonic oscillator in the fictitious time s, dt = r ds; positions are quadratic in the
+// oscillator's state, so a collision orbit passes through r = 0 without losing precision
+void ksDrift(double gm, glm::dvec3& position, glm::dvec3& velocity, double dt) {
+	glm::dvec4 u0 = toKS(position);
+	glm::dvec4 du0 = 0.5 * ksTranspose(u0, glm::dvec4(velocity, 0.0));
+	double r0 = glm::dot(u0, u0);
+	if (r0 == 0.0)
+		return;
+
+	// u'' = -beta u, with the energy per unit reduced mass h = -2 beta
+	double beta = (0.5 * gm - glm::dot(du0, du0)) / r0;
+	double eta = 2.0 * glm::dot(u0, du0);
+	double speed2 = glm::dot(du0, du0);
+
+	// fictitious time s solving t(s) = dt, with t(s) = r0 s (1 + c1) / 2 + eta s^2 c2 + 2 |u'|^2 s^3 c3 at 4 beta s^2,
+	// by Laguerre-Conway iteration as for the universal Kepler equation, t' = |u|^2 never vanishing
+	// on a bound orbit t(s) grows at the semi-major axis, (r0 + |u'|^2 / beta) / 2, plus a bounded oscillation
+	double s = beta > 0.0 ? dt / (0.5 * (r0 + speed2 / beta)) : dt / r0;
+	double c[4], d[4];
+	glm::dvec4 u = u0, du = du0;
+	for (int iteration = 0; iteration < KEPLER_MAX_ITERATIONS; iteration++) {
+		stumpff(4.0 * beta * s * s, c);
+		stumpff(beta * s * s, d);
+		u = u0 * d[0] + du0 * (s * d[1]);
+		du = du0 * d[0] - u0 * (beta * s * d[1]);
+
+		double f = 0.5 * r0 * s * (1.0 + c[1]) + eta * s * s * c[2] + 2.0 * speed2 * s * s * s * c[3] - dt;
+		double df = glm::dot(u, u);
+		double d2f = 2.0 * glm::dot(u, du);
+
+		const double order = 5.0;
+		double root = sqrt(fabs((order - 1.0) * (order - 1.0) * df * df - order * (order - 1.0) * f * d2f));
+		double ds = order * f / (df + (df > 0.0 ? root : -root));
+		s -= ds;
+		if (fabs(ds) <= 1e-15 * fabs(s))
+			break;
+	}
+
+	stumpff(beta * s * s, d);
+	u = u0 * d[0] + du0 * (s * d[1]);
+	du = du0 * d[0] - u0 * (beta * s * d[1]);
+
+	position = glm::dvec3(ksMatrix(u, u));
+	velocity = glm::dvec3(ksMatrix(u, du)) * (2.0 / glm::dot(u, u));
+}
+
+// pairs for a step of dt, chosen from the accelerations left in the store by the last force pass;
+// each body joins at most one pair, the tightest ones first
+void Regularization::select(const BodyStore& s, double dt) {
+	PhaseTimer timer(PHASE_REGULARIZATION);
+	pairs.clear();
+	size_t n = s.size();
+	if (n < 2)
+		return;
+
+	// no pair can be tight enough beyond the separation at which the two heaviest bodies would be
+	double span = KS_STEPS * fabs(dt);
+	double heaviest = *std::max_element(s.mass.begin(), s.mass.end());
+	double reach = cbrt(span * span * G * 2.0 * heaviest);
+
+	sorted.resize(n);
+	for (size_t i = 0; i < n; i++)
+		sorted[i] = std::make_pair(s.px[i], (uint32_t)i);
+	std::sort(sorted.begin(), sorted.end());
+
+	struct Candidate {
+		double time;
+		uint32_t a, b;
+	};
+	std::vector<Candidate> candidates;
+	for (size_t k = 0; k < n; k++) {
+		uint32_t a = sorted[k].second;
+		for (size_t m = k + 1; m < n && sorted[m].first - sorted[k].first <= reach; m++) {
+			uint32_t b = sorted[m].second;
+			glm::dvec3 separation = s.position(b) - s.position(a);
+			double r2 = glm::dot(separation, separation);
+			if (r2 == 0.0 || r2 > reach * reach)
+				continue;
+
+			double r = sqrt(r2);
+			double gm = G * (s.mass[a] + s.mass[b]);
+			double time = sqrt(r2 * r / gm);
+			if (!(time < span))
+				continue;
+
+			// what remains of the relative acceleration without the mutual attraction is the tide on the pair
+			glm::dvec3 mutual = separation * (-gm / (r2 * r));
+			glm::dvec3 tide = s.acceleration(b) - s.acceleration(a) - mutual;
+			if (glm::length(tide) < KS_PERTURBATION * gm / r2)
+				candidates.push_back(Candidate{ time, a, b });
+		}
+	}
+	if (candidates.empty())
+		return;
+
+	std::sort(candidates.begin(), candidates.end(),
+		[](const Candidate& x, const Candidate& y) { return x.time < y.time; });
+	std::vector<uint8_t> paired(n, 0);
+	for (const Candidate& candidate : candidates) {
+		if (paired[candidate.a] || paired[candidate.b])
+			continue;
+		paired[candidate.a] = paired[candidate.b] = 1;
+		pairs.push_back(ClosePair{ candidate.a, candidate.b });
+	}
+}
+
+// adds sign times the point-mass attraction between the members of every pair to their accelerations
+void Regularization::addMutual(BodyStore& s, double sign) const {
+	for (const ClosePair& pair : pairs) {
+		glm::dvec3 separation = s.position(pair.b) - s.position(pair.a);
+		double r = glm::length(separation);
+		glm::dvec3 pull = separation * (sign * G / (r * r * r));
+		s.ax[pair.a] += pull.x * s.mass[pair.b];
+		s.ay[pair.a] += pull.y * s.mass[pair.b];
+		s.az[pair.a] += pull.z * s.mass[pair.b];
+		s.ax[pair.b] -= pull.x * s.mass[pair.a];
+		s.ay[pair.b] -= pull.y * s.mass[pair.a];
+		s.az[pair.b] -= pull.z * s.mass[pair.a];
+	}
+}
+
+void Regularization::save(const BodyStore& s) {
+	start.resize(2 * pairs.size());
+	for (size_t k = 0; k < pairs.size(); k++) {
+		start[2 * k] = s.position(pairs[k].a);
+		start[2 * k + 1] = s.position(pairs[k].b);
+	}
+}
+
+// replaces the straight drift of the pair members since save with the drift of their barycenter
+// and the Kepler motion of their separation, keeping the velocities of the last kick
+void Regularization::drift(BodyStore& s, double dt) const {
+	PhaseTimer timer(PHASE_REGULARIZATION);
+	for (size_t k = 0; k < pairs.size(); k++) {
+		uint32_t a = pairs[k].a, b = pairs[k].b;
+		double total = s.mass[a] + s.mass[b];
+		double shareA = s.mass[a] / total, shareB = s.mass[b] / total;
+
+		glm::dvec3 center = shareA * start[2 * k] + shareB * start[2 * k + 1];
+		glm::dvec3 centerVelocity = shareA * s.velocity(a) + shareB * s.velocity(b);
+		glm::dvec3 separation = start[2 * k + 1] - start[2 * k];
+		glm::dvec3 relativeVelocity = s.velocity(b) - s.velocity(a);
+
+		ksDrift(G * total, separation, relativeVelocity, dt);
+		center += centerVelocity * dt;
+
+		glm::dvec3 positionA = center - shareB * separation, positionB = center + shareA * separation;
+		glm::dvec3 velocityA = centerVelocity - shareB * relativeVelocity;
+		glm::dvec3 velocityB = centerVelocity + shareA * relativeVelocity;
+		s.px[a] = positionA.x;
+		s.py[a] = positionA.y;
+		s.pz[a] = positionA.z;
+		s.px[b] = positionB.x;
+		s.py[b] = positionB.y;
+		s.pz[b] = positionB.z;
+		s.vx[a] = velocityA.x;
+		s.vy[a] = velocityA.y;
+		s.vz[a] = velocityA.z;
+		s.vx[b] = velocityB.x;
+		s.vy[b] = velocityB.y;
+		s.vz[b] = velocityB.z;
+		s.clearCarry(a);
+		s.clearCarry(b);
+	}
+}
\ No newline at end of file
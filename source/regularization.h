@@ -0,0 +1,30 @@
+#pragma once
+
+#include "forces.h"
+
+// a pair is regularized while the dynamical time sqrt(r^3 / G(m1 + m2)) of its relative orbit is under this many steps
+const double KS_STEPS = 10.0;
+// and while the rest of the system pulls the two apart by less than this fraction of their mutual attraction
+const double KS_PERTURBATION = 0.05;
+
+struct ClosePair {
+	uint32_t a, b;
+};
+
+// close pairs too tight for the step, whose relative motion is moved by an exact Kepler drift in
+// Kustaanheimo-Stiefel coordinates while the rest of the system steps as usual; the pull of everything
+// else on the two, tides included, still comes from the kicks, from which only their mutual attraction is taken out
+class Regularization {
+public:
+	std::vector<ClosePair> pairs;
+
+	void select(const BodyStore& s, double dt);
+	void addMutual(BodyStore& s, double sign) const;
+	void save(const BodyStore& s);
+	void drift(BodyStore& s, double dt) const;
+private:
+	std::vector<std::pair<double, uint32_t>> sorted;	// bodies by x, for the sweep that finds candidates
+	std::vector<glm::dvec3> start;						// positions of the pair members before the drift
+};
+
+void ksDrift(double gm, glm::dvec3& position, glm::dvec3& velocity, double dt);
\ No newline at end of file
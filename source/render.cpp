@@ -1,6 +1,10 @@
 ﻿#include "render.h"
 #include "controls.h"
 #include "barycenter.h"
+#include "fmm.h"
+#include "particlemesh.h"
+#include "blockstep.h"
+#include "gaussradau.h"
 #include <mutex>
 #include "imgui.h"
 #include "backends/imgui_impl_glfw.h"
@@ -368,14 +372,19 @@ static void updateLockCam(Camera& eye) {
 
 static void updateGravCam(Camera& eye) {
 	if (hasPhysics) {
+		std::lock_guard<std::mutex> lock(physicsMutex);
 		std::shared_ptr<GravityBody> camBody = bodies[eye.eyeIndex];
 		eye.position = camBody->position;
 
 		if (&eye == &camera) {
 			flyCam(window);
 
-			bodies[eye.eyeIndex]->position += eye.velocity * deltaTime;
-			bodies[eye.eyeIndex]->velocity += eye.velocity;
+			// only a push edits the body, so the simulation and its monitor carry on without one
+			if (eye.velocity != glm::dvec3(0.0)) {
+				bodies[eye.eyeIndex]->position += eye.velocity * deltaTime;
+				bodies[eye.eyeIndex]->velocity += eye.velocity;
+				reloadState = true;
+			}
 		}
 	}
 }
@@ -750,6 +759,9 @@ static void renderPIP() {
 	drawQuad();  // Assume a quad is already defined for rendering
 }
 
+// steps drained from the physics profiler, newest last
+static std::vector<StepProfile> profileHistory;
+
 static void drawGUI() {
 	ImGui_ImplOpenGL3_NewFrame();
 	ImGui_ImplGlfw_NewFrame();
@@ -870,10 +882,17 @@ static void drawGUI() {
 			ImGuiWindowFlags_AlwaysAutoResize |
 			ImGuiWindowFlags_NoTitleBar);
 
-		ImGui::Text("Elapsed time: %.1f yrs", elapsedTime / 86400 / 365.25);
-		ImGui::Text("Time Step: %.3f s", frameTime);
+		ImGui::Text("Elapsed time: %.1f yrs", simulation.elapsedTime / 86400 / 365.25);
+		ImGui::Text("Time Step: %.3g s, %.3g s per frame", simulationStep, frameTime);
+		if (simulationLag > 0.0 || droppedTime > 0.0)
+			ImGui::Text("Behind: %.3g s pending, %.3g s dropped", simulationLag, droppedTime);
+		if (integrator == BLOCK_TIMESTEPS)
+			ImGui::Text("Block Levels: %d, %zu evaluations", simulation.block.depth, simulation.block.evaluations);
+		if (integrator == GAUSS_RADAU)
+			ImGui::Text("Adaptive Step: %.3g s x %zu, error %.1e",
+				simulation.radau.stepSize, simulation.radau.stepsTaken, simulation.radau.errorEstimate);
 		ImGui::Text("Frame Time: %.3f ms", deltaTime * 1000);
-		ImGui::Text("%.3f s", elapsedTime);
+		ImGui::Text("%.3f s", simulation.elapsedTime);
 
 		ImGui::End();
 	}
@@ -886,17 +905,104 @@ static void drawGUI() {
 			ImGuiWindowFlags_AlwaysAutoResize);
 
 		float timeStepLog = (float)log10(timeStep);
+		float stepSizeLog = (float)log10(simulationStep);
 
 		ImGui::Checkbox("Physics", &hasPhysics);
-		ImGui::Text("Time Step (Logarithmic)");
+		ImGui::Text("Simulation Rate (Logarithmic)");
 		ImGui::SliderFloat("##timestep", &timeStepLog, 0, 10);
+		ImGui::Text("Step Size (Logarithmic)");
+		ImGui::SliderFloat("##stepsize", &stepSizeLog, -1, 6);
 		ImGui::Checkbox("Trails", &doTrails);
+		ImGui::Checkbox("Merge Collisions", &doCollisions);
+
+		int method = integrator;
+		float eta = (float)blockAccuracy;
+		float toleranceLog = (float)log10(radauTolerance);
+		ImGui::Combo("Integrator", &method, "Leapfrog\0Block Timesteps\0Hermite\0IAS15\0Wisdom-Holman\0Yoshida 4\0Yoshida 6\0Yoshida 8\0");
+		if (method == BLOCK_TIMESTEPS)
+			ImGui::SliderFloat("Timestep Accuracy", &eta, 0.001f, 0.1f, "%.3f");
+		if (method == HERMITE)
+			ImGui::Text("Forces and jerks summed directly");
+		if (method == GAUSS_RADAU) {
+			ImGui::SliderFloat("Tolerance (log10)", &toleranceLog, -12, -4, "%.1f");
+			ImGui::Text("Forces summed directly");
+		}
+		if (method == WISDOM_HOLMAN)
+			ImGui::Text("Kepler drifts about each parent, forces summed directly");
+		if (method == LEAPFROG || method >= YOSHIDA_4) {
+			ImGui::Checkbox("Regularize Close Pairs", &doRegularization);
+			ImGui::Checkbox("Compensated Sums", &doCompensatedSums);
+			ImGui::Text("Regularized Pairs: %zu", simulation.regularization.pairs.size());
+		}
+
+		int engine = forceEngine;
+		float theta = (float)openingAngle;
+		int order = multipoleOrder;
+		int meshLog = (int)round(log2(meshSize));
+		int assignment = meshAssignment;
+		ImGui::Combo("Force Engine", &engine, "Direct\0Barnes-Hut\0FMM\0Particle Mesh\0");
+		if (engine == BARNES_HUT || engine == FMM)
+			ImGui::SliderFloat("Opening Angle", &theta, 0, 1);
+		if (engine == FMM) {
+			ImGui::SliderInt("Expansion Order", &order, 0, FMM_MAX_ORDER);
+			ImGui::Text("Force Error: %.1e rms, %.1e max", simulation.multipole.errorRms.load(), simulation.multipole.errorMax.load());
+		}
+		if (engine == PARTICLE_MESH) {
+			ImGui::SliderInt("Mesh Size (log2)", &meshLog, 4, 8);
+			ImGui::Combo("Assignment", &assignment, "CIC\0TSC\0");
+			ImGui::Checkbox("P3M Correction", &shortRangeCorrection);
+		}
+		ImGui::Checkbox("J2 Field", &oblateGravity);
+		ImGui::SameLine();
+		ImGui::Checkbox("J2 Torque", &oblateTorques);
+		ImGui::Checkbox("Relativity (1PN)", &postNewtonian);
+		if (postNewtonian && engine != DIRECT)
+			ImGui::Text("Relativity is only summed by the direct engine");
+
+		// steps between samples on a log scale, the leftmost position switches the monitor off
+		int monitorLog = conservationInterval == 0 ? -1 : (int)round(log10((double)conservationInterval));
+		ImGui::SliderInt("Conservation Monitor (log10 steps)", &monitorLog, -1, 5, monitorLog < 0 ? "Off" : "%d");
+		conservationInterval = monitorLog < 0 ? 0 : (size_t)pow(10.0, monitorLog);
+		const ConservationMonitor& monitor = simulation.monitor;
+		if (conservationInterval > 0 && monitor.sampled) {
+			ImGui::Text("Energy Drift: %.2e", monitor.energyDrift);
+			ImGui::Text("Momentum Drift: %.2e", monitor.momentumDrift);
+			ImGui::Text("Angular Momentum Drift: %.2e", monitor.angularDrift);
+			if (!monitor.pointMassesOnly)
+				ImGui::Text("Drifts of the point masses only, the J2 and 1PN terms are left out");
+		}
+
+		// mean time of every phase over the steps of about the last second
+		ImGui::Checkbox("Profile Steps", &doProfiling);
+		if (doProfiling && !profileHistory.empty()) {
+			size_t recent = std::min(profileHistory.size(), (size_t)PROFILE_HISTORY);
+			StepProfile mean = averageProfile(profileHistory, recent);
+			ImGui::Text("Step: %.3f ms over %zu steps, %llu dropped", mean.total * 1e3, recent,
+				(unsigned long long)profiler.dropped.load());
+			for (int p = 0; p < PHASE_COUNT; p++) {
+				if (mean.phase[p] > 0.0)
+					ImGui::Text("  %-16s %8.3f ms %5.1f%%", phaseNames[p], mean.phase[p] * 1e3, 100.0 * mean.phase[p] / mean.total);
+			}
+			if (ImGui::Button("Export Profile")) {
+				writeProfileCSV(PROFILE_CSV, profileHistory);
+				writeProfileJSON(PROFILE_JSON, profileHistory);
+			}
+		}
 
 		ImGui::SetWindowPos(ImVec2(ImGui::GetIO().DisplaySize.x - ImGui::GetWindowSize().x - padding, padding), ImGuiCond_Always);
 
 		ImGui::End();
 
 		timeStep = pow(10.0, (double)timeStepLog);
+		simulationStep = pow(10.0, (double)stepSizeLog);
+		integrator = (integration_method)method;
+		blockAccuracy = eta;
+		radauTolerance = pow(10.0, (double)toleranceLog);
+		forceEngine = (force_engine)engine;
+		openingAngle = theta;
+		multipoleOrder = order;
+		meshSize = 1 << meshLog;
+		meshAssignment = (mesh_assignment)assignment;
 	}
 	else {
 		ImGui::SetNextWindowPos(ImVec2(ImGui::GetIO().DisplaySize.x - 50 - padding, padding), ImGuiCond_Always);
@@ -940,9 +1046,8 @@ static void updateRenderContext() {
 	// capture physics results when they are ready
 	std::unique_lock<std::mutex> lock(physicsMutex);
 	physicsDone.wait(lock);
-	lock.unlock();
 
-	// transfer entities from physics thread to rendering buffers
+	// transfer entities from physics thread to rendering buffers, under the lock as merges shorten the lists
 	frameBodies.clear();
 	frameEntities.clear();
 	for (const std::shared_ptr<GravityBody>& body : bodies) {
@@ -954,6 +1059,7 @@ static void updateRenderContext() {
 			}
 		}
 	}
+	lock.unlock();
 
 	if (!doTrails && trailVertices.size() > 0) {
 		for (const std::shared_ptr<GravityBody>& body : bodies) {
@@ -966,6 +1072,12 @@ static void updateRenderContext() {
 
 	if (doTrails)
 		updateTrails(frameBodies);
+
+	if (doProfiling) {
+		std::vector<StepProfile> fresh;
+		profiler.drain(fresh);
+		appendProfiles(profileHistory, fresh);
+	}
 }
 
 void renderLoop() {
@@ -0,0 +1,66 @@
+#include "rotation.h"
+#include "profiler.h"
+
+// bodies of the last batch by path, per simulation thread like the force buffers
+static thread_local std::vector<uint32_t> freeBodies, torquedBodies;
+
+glm::dquat freeRotation(const glm::dquat& orientation, const glm::dvec3& momentum, const glm::dvec3& momentOfInertia, double dt) {
+	double length = glm::length(momentum);
+	if (length == 0.0)
+		return orientation;
+
+	glm::dvec3 axis = orientation * glm::dvec3(0.0, 1.0, 0.0);
+	double spinRate = glm::dot(momentum, axis) * (1.0 / momentOfInertia.y - 1.0 / momentOfInertia.x);
+
+	glm::dquat precession = glm::angleAxis(length / momentOfInertia.x * dt, momentum / length);
+	glm::dquat spin = glm::angleAxis(spinRate * dt, glm::dvec3(0.0, 1.0, 0.0));
+	return glm::normalize(precession * orientation * spin);
+}
+
+// orientation of one body after dt, with the angular momentum already kicked to the middle of the step
+void rotateBody(BodyStore& s, size_t i, double dt) {
+	if (rotatesFreely(s, i)) {
+		if (s.angularMomentum[i] == glm::dvec3(0.0))
+			return;
+		s.orientation[i] = freeRotation(s.orientation[i], s.angularMomentum[i], s.momentOfInertia[i], dt);
+	}
+	else {
+		s.orientation[i] = GravityBody::rotateRK4(
+			s.orientation[i], s.angularMomentum[i], s.torque[i], s.momentOfInertia[i], dt);
+	}
+	s.refreshAxis(i);
+}
+
+// every body over one shared step: bodies without spin are skipped, those rotating freely take the closed form
+// in one pass, and only those under torque or without an axis of symmetry go through the RK4 steps
+void rotateBodies(BodyStore& s, double dt) {
+	PhaseTimer timer(PHASE_ROTATION);
+	std::vector<uint32_t>& rotating = freeBodies;
+	std::vector<uint32_t>& torqued = torquedBodies;
+	rotating.clear();
+	torqued.clear();
+	for (size_t i = 0; i < s.size(); i++) {
+		if (!rotatesFreely(s, i))
+			torqued.push_back((uint32_t)i);
+		else if (s.angularMomentum[i] != glm::dvec3(0.0))
+			rotating.push_back((uint32_t)i);
+	}
+
+	#pragma omp parallel
+	{
+		#pragma omp for schedule(static) nowait
+		for (int k = 0; k < (int)rotating.size(); k++) {
+			uint32_t i = rotating[k];
+			s.orientation[i] = freeRotation(s.orientation[i], s.angularMomentum[i], s.momentOfInertia[i], dt);
+			s.refreshAxis(i);
+		}
+
+		#pragma omp for schedule(dynamic, 16)
+		for (int k = 0; k < (int)torqued.size(); k++) {
+			uint32_t i = torqued[k];
+			s.orientation[i] = GravityBody::rotateRK4(
+				s.orientation[i], s.angularMomentum[i], s.torque[i], s.momentOfInertia[i], dt);
+			s.refreshAxis(i);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "bodystore.h"
+
+// orientation after dt of a body under no torque, exact when its two equatorial moments are equal:
+// the body precesses about its fixed angular momentum at |L| / I_equatorial while it spins about its own axis
+// at L_axis (1 / I_axis - 1 / I_equatorial); a sphere only does the first
+glm::dquat freeRotation(const glm::dquat& orientation, const glm::dvec3& momentum, const glm::dvec3& momentOfInertia, double dt);
+
+// whether freeRotation moves the body exactly
+inline bool rotatesFreely(const BodyStore& s, size_t i) {
+	return s.torque[i] == glm::dvec3(0.0) && s.momentOfInertia[i].x == s.momentOfInertia[i].z;
+}
+
+void rotateBody(BodyStore& s, size_t i, double dt);
+void rotateBodies(BodyStore& s, double dt);
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include "simulation.h"
+#include "symplectic.h"
+
+const char* const integratorNames[INTEGRATOR_COUNT] = {
+	"leapfrog", "block", "hermite", "ias15", "wisdom-holman", "yoshida4", "yoshida6", "yoshida8"
+};
+
+bool choosesOwnSteps(integration_method method) {
+	return method == BLOCK_TIMESTEPS || method == GAUSS_RADAU;
+}
+
+// gathers the bodies into the store, the clock keeps running across reloads
+void Simulation::load(const context& bodies) {
+	state.load(bodies);
+	reset();
+	monitor.restart();
+}
+
+// integrators that carry state between steps start over from the store
+void Simulation::reset() {
+	block.reset();
+	hermite.reset();
+	radau.reset();
+	wisdomHolman.reset();
+	particles.reset();
+	floatParticles.reset();
+	state.clearCarries();
+}
+
+// test particles take a single leapfrog step and collisions a single straight sweep over each call, so with either
+// in play every call keeps to one simulation step; otherwise the integrators choosing their own steps take a chunk
+size_t Simulation::stepsPerCall() const {
+	bool perStep = mergeCollisions || particles.size() > 0 || floatParticles.size() > 0;
+	return choosesOwnSteps(integrator) && !perStep ? ADAPTIVE_CHUNK : 1;
+}
+
+// dt spans the given number of simulation steps, which the monitor counts toward its interval
+// returns whether bodies merged, after which the store is shorter and collisions.remap maps the old indices
+bool Simulation::step(double dt, size_t steps) {
+	if (integrator != previous || compensated != wasCompensated) {
+		reset();
+		previous = integrator;
+		wasCompensated = compensated;
+	}
+
+	activeProfiler = profiler;
+	activeMultipole = &multipole;
+	if (profiler)
+		profiler->beginStep();
+
+	monitor.begin(state);
+	particles.beginStep(state, dt);
+	floatParticles.beginStep(state, dt);
+
+	// close pairs for the symplectic integrators, except under the mesh, whose short-range forces are softened
+	Regularization* close = nullptr;
+	bool symplectic = integrator == LEAPFROG || integrator >= YOSHIDA_4;
+	if (regularize && symplectic && forceEngine != PARTICLE_MESH) {
+		regularization.select(state, dt);
+		if (!regularization.pairs.empty())
+			close = &regularization;
+	}
+	else
+		regularization.pairs.clear();
+
+	switch (integrator) {
+	case BLOCK_TIMESTEPS:
+		block.step(state, dt, blockAccuracy);
+		break;
+	case HERMITE:
+		hermite.step(state, dt);
+		break;
+	case GAUSS_RADAU:
+		radau.step(state, dt);
+		break;
+	case WISDOM_HOLMAN:
+		wisdomHolman.step(state, dt);
+		break;
+	case YOSHIDA_4:
+		compensated ? yoshidaStep<4, CompensatedSum>(state, dt, close) : yoshidaStep<4>(state, dt, close);
+		break;
+	case YOSHIDA_6:
+		compensated ? yoshidaStep<6, CompensatedSum>(state, dt, close) : yoshidaStep<6>(state, dt, close);
+		break;
+	case YOSHIDA_8:
+		compensated ? yoshidaStep<8, CompensatedSum>(state, dt, close) : yoshidaStep<8>(state, dt, close);
+		break;
+	default:
+		compensated ? leapfrogStep<CompensatedSum>(state, dt, close) : leapfrogStep(state, dt, close);
+		break;
+	}
+
+	particles.endStep(state, dt);
+	floatParticles.endStep(state, dt);
+	elapsedTime += dt;
+
+	// a merge changes the bodies under every integrator that keeps its own copy of them
+	bool merged = mergeCollisions && collisions.resolve(state);
+	if (merged)
+		reset();
+
+	monitor.step(state, dt, steps);
+
+	if (profiler)
+		profiler->endStep();
+	activeProfiler = nullptr;
+	activeMultipole = nullptr;
+	return merged;
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "blockstep.h"
+#include "hermite.h"
+#include "gaussradau.h"
+#include "wisdomholman.h"
+#include "collisions.h"
+#include "testparticles.h"
+#include "regularization.h"
+#include "conservation.h"
+#include "profiler.h"
+#include "fmm.h"
+
+enum integration_method : uint8_t {
+	LEAPFROG,
+	BLOCK_TIMESTEPS,
+	HERMITE,
+	GAUSS_RADAU,
+	WISDOM_HOLMAN,
+	YOSHIDA_4,
+	YOSHIDA_6,
+	YOSHIDA_8,
+	INTEGRATOR_COUNT
+};
+
+extern const char* const integratorNames[INTEGRATOR_COUNT];
+
+// whether one step call covers its interval with steps of the integrator's own choosing
+bool choosesOwnSteps(integration_method method);
+
+// simulation steps the interactive loop hands an integrator choosing its own steps in one call, fixed rather than
+// fitted to the wall clock so the call boundaries, where such an integrator lands exactly, repeat from run to run
+const size_t ADAPTIVE_CHUNK = 16;
+
+// one self-contained system: the store of its bodies, the state of every integrator and its own clock
+// nothing is shared between simulations, so any number of them can step at the same time on different threads;
+// the force engine settings stay global and are only read while stepping
+class Simulation {
+public:
+	BodyStore state;
+	integration_method integrator = LEAPFROG;
+	bool mergeCollisions = false;	// merge bodies that meet at the end of every step
+	bool regularize = true;			// move close pairs along their relative orbit under the symplectic integrators
+	bool compensated = false;		// carry the rounding of every symplectic kick and drift into the next
+	double elapsedTime = 0.0;
+
+	BlockTimesteps block;
+	HermiteIntegrator hermite;
+	GaussRadau radau;
+	WisdomHolman wisdomHolman;
+	Collisions collisions;
+	Regularization regularization;
+	TestParticles particles;	// stepped alongside the bodies, outside of the force engine
+	FloatParticles floatParticles;	// the same in single precision, for populations too large for double
+	ConservationMonitor monitor;	// off until given an interval
+	StepProfiler* profiler = nullptr;	// times the phases of every step while set
+	FastMultipole multipole;	// expansions of the FMM engine and the force error they last sampled
+
+	void load(const context& bodies);
+	bool step(double dt, size_t steps = 1);
+	size_t stepsPerCall() const;
+	void reset();
+private:
+	integration_method previous = LEAPFROG;
+	bool wasCompensated = false;
+};
\ No newline at end of file
@@ -1,9 +1,12 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #include "surface.h"
+#include "util.h"
 
 GLuint Surface::importTexture(const char* path, bool useInterpolation) {
 	GLuint texture = 0;
+	if (headless)
+		return texture;
 
 	int width, height, numChannels;
 	unsigned char* data = stbi_load(path, &width, &height, &numChannels, 0);
@@ -63,6 +66,9 @@ Surface::Surface(const char* path, glm::vec4 material, glm::vec3 color) {
 
 Surface Surface::CubeMap(std::vector<std::string> faces) {
 	Surface out;
+	if (headless)
+		return out;
+
 	glGenTextures(1, &out.texture);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, out.texture);
 
@@ -0,0 +1,75 @@
+#include "symplectic.h"
+#include "rotation.h"
+#include "profiler.h"
+
+// one kick-drift-kick substep from the accelerations already in the store, leaving those of its end
+// the close pairs, if any, are kicked without their mutual attraction and drift along their relative orbit instead
+template <class Sum>
+void kickDriftKick(BodyStore& s, double dt, Regularization* close) {
+	double halfDt = dt * 0.5;
+	int n = (int)s.size();
+
+	if (close) {
+		close->addMutual(s, -1.0);
+		close->save(s);
+	}
+
+	// Update velocities and positions by half-step, clear accelerations
+	{
+		PhaseTimer timer(PHASE_DRIFT);
+		#pragma omp parallel for
+		for (int i = 0; i < n; i++) {
+			Sum::add(s.vx[i], s.cvx[i], s.ax[i] * halfDt);
+			Sum::add(s.vy[i], s.cvy[i], s.ay[i] * halfDt);
+			Sum::add(s.vz[i], s.cvz[i], s.az[i] * halfDt);
+
+			Sum::add(s.px[i], s.cpx[i], s.vx[i] * dt);
+			Sum::add(s.py[i], s.cpy[i], s.vy[i] * dt);
+			Sum::add(s.pz[i], s.cpz[i], s.vz[i] * dt);
+
+			s.torque[i] = glm::dvec3(s.tx[i], s.ty[i], s.tz[i]);
+			s.angularMomentum[i] += s.torque[i] * halfDt;
+		}
+	}
+	rotateBodies(s, dt);
+
+	if (close)
+		close->drift(s, dt);
+
+	s.clearForces();
+
+	// Compute forces between particles
+	computeForces(s);
+	if (close)
+		close->addMutual(s, -1.0);
+
+	// Update velocities to full-step using the new accelerations
+	{
+		PhaseTimer timer(PHASE_KICK);
+		#pragma omp parallel for
+		for (int i = 0; i < n; i++) {
+			Sum::add(s.vx[i], s.cvx[i], s.ax[i] * halfDt);
+			Sum::add(s.vy[i], s.cvy[i], s.ay[i] * halfDt);
+			Sum::add(s.vz[i], s.cvz[i], s.az[i] * halfDt);
+			s.angularMomentum[i] += s.torque[i] * halfDt;
+		}
+	}
+
+	// the store keeps the full accelerations between substeps
+	if (close)
+		close->addMutual(s, 1.0);
+}
+
+// kick-drift-kick leapfrog with one step shared by every body
+template <class Sum>
+void leapfrogStep(BodyStore& s, double dt, Regularization* close) {
+	for (size_t i = 0; i < s.size(); i++)
+		s.prevPosition[i] = s.position(i);
+
+	kickDriftKick<Sum>(s, dt, close);
+}
+
+template void kickDriftKick<PlainSum>(BodyStore& s, double dt, Regularization* close);
+template void kickDriftKick<CompensatedSum>(BodyStore& s, double dt, Regularization* close);
+template void leapfrogStep<PlainSum>(BodyStore& s, double dt, Regularization* close);
+template void leapfrogStep<CompensatedSum>(BodyStore& s, double dt, Regularization* close);
\ No newline at end of file
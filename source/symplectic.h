@@ -0,0 +1,79 @@
+#pragma once
+
+#include <utility>
+#include "regularization.h"
+
+// weights of Yoshida's symmetric compositions of the leapfrog (Phys. Lett. A 150, 1990), outermost first
+// the sequence mirrors about its last weight, the one that makes the weights sum to one
+template <int Order>
+struct Yoshida;
+
+// triple jump
+template <>
+struct Yoshida<4> {
+	static constexpr double w1 = 1.3512071919596578;
+	static constexpr double weights[] = { w1, 1.0 - 2.0 * w1 };
+};
+
+// solution A
+template <>
+struct Yoshida<6> {
+	static constexpr double w1 = -1.17767998417887;
+	static constexpr double w2 = 0.235573213359357;
+	static constexpr double w3 = 0.784513610477560;
+	static constexpr double weights[] = { w3, w2, w1, 1.0 - 2.0 * (w1 + w2 + w3) };
+};
+
+// solution D
+template <>
+struct Yoshida<8> {
+	static constexpr double w1 = 0.102799849391985;
+	static constexpr double w2 = -1.96061023297549;
+	static constexpr double w3 = 1.93813913762276;
+	static constexpr double w4 = -0.158240635368243;
+	static constexpr double w5 = -1.44485223686048;
+	static constexpr double w6 = 0.253693336566229;
+	static constexpr double w7 = 0.914844246229740;
+	static constexpr double weights[] = { w7, w6, w5, w4, w3, w2, w1, 1.0 - 2.0 * (w1 + w2 + w3 + w4 + w5 + w6 + w7) };
+};
+
+// how the kicks and drifts add their increments to positions and velocities
+// plain sums round once per addition, a random walk in the last bit that over millions of steps shows in the energy
+struct PlainSum {
+	static inline void add(double& sum, double&, double term) {
+		sum += term;
+	}
+};
+
+// Kahan's compensated sums: what each addition rounds off is kept in a carry per coordinate and fed into the next,
+// so the state holds close to twice the digits of a double across steps at the cost of three more additions
+struct CompensatedSum {
+	static inline void add(double& sum, double& carry, double term) {
+		double y = term + carry;
+		double t = sum + y;
+		carry = y - (t - sum);
+		sum = t;
+	}
+};
+
+template <class Sum = PlainSum>
+void kickDriftKick(BodyStore& s, double dt, Regularization* close = nullptr);
+template <class Sum = PlainSum>
+void leapfrogStep(BodyStore& s, double dt, Regularization* close = nullptr);
+
+template <int Order, class Sum, size_t... Stage>
+void composedSteps(BodyStore& s, double dt, Regularization* close, std::index_sequence<Stage...>) {
+	constexpr size_t middle = std::size(Yoshida<Order>::weights) - 1;
+	(kickDriftKick<Sum>(s, Yoshida<Order>::weights[Stage <= middle ? Stage : 2 * middle - Stage] * dt, close), ...);
+}
+
+// one step of the given order as 2 * weights - 1 leapfrog substeps, expanded at compile time;
+// the closing kick of each substep and the opening kick of the next share one force evaluation
+template <int Order, class Sum = PlainSum>
+void yoshidaStep(BodyStore& s, double dt, Regularization* close = nullptr) {
+	for (size_t i = 0; i < s.size(); i++)
+		s.prevPosition[i] = s.position(i);
+
+	constexpr size_t stages = 2 * std::size(Yoshida<Order>::weights) - 1;
+	composedSteps<Order, Sum>(s, dt, close, std::make_index_sequence<stages>());
+}
\ No newline at end of file
@@ -0,0 +1,115 @@
+#include "taskpool.h"
+
+// the pool and queue of the worker running on this thread, if any
+static thread_local const TaskPool* currentPool = nullptr;
+static thread_local size_t currentQueue = 0;
+
+size_t threadCount(int setting) {
+	if (setting > 0)
+		return (size_t)setting;
+	return std::max(1u, std::thread::hardware_concurrency());
+}
+
+size_t spareThreads(size_t taken) {
+	size_t hardware = threadCount(0);
+	return hardware > taken ? hardware - taken : 0;
+}
+
+TaskPool::~TaskPool() {
+	stop();
+}
+
+// the pool must be idle while its workers are replaced
+void TaskPool::resize(size_t workers) {
+	stop();
+	stopping = false;
+	queues.clear();
+	for (size_t i = 0; i <= workers; i++)
+		queues.push_back(std::make_unique<Queue>());
+	for (size_t i = 0; i < workers; i++)
+		threads.emplace_back(&TaskPool::work, this, i);
+}
+
+void TaskPool::stop() {
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& thread : threads)
+		thread.join();
+	threads.clear();
+}
+
+// own deque for a worker of this pool, the shared one for everyone else
+size_t TaskPool::home() const {
+	return currentPool == this ? currentQueue : threads.size();
+}
+
+void TaskPool::run(TaskGroup& group, std::function<void()> work) {
+	if (threads.empty()) {
+		work();
+		return;
+	}
+
+	group.pending.fetch_add(1, std::memory_order_relaxed);
+	Queue& queue = *queues[home()];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks.push_back(Task{ std::move(work), &group });
+	}
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		queued.fetch_add(1, std::memory_order_relaxed);
+	}
+	wake.notify_one();
+}
+
+// newest task of the given queue, or failing that the oldest of the next queue holding any
+bool TaskPool::runOne(size_t queue) {
+	Task task;
+	{
+		Queue& own = *queues[queue];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.tasks.empty()) {
+			task = std::move(own.tasks.back());
+			own.tasks.pop_back();
+		}
+	}
+	for (size_t k = 1; !task.group && k < queues.size(); k++) {
+		Queue& victim = *queues[(queue + k) % queues.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.tasks.empty()) {
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+		}
+	}
+	if (!task.group)
+		return false;
+
+	queued.fetch_sub(1, std::memory_order_relaxed);
+	task.work();
+	task.group->pending.fetch_sub(1, std::memory_order_release);
+	return true;
+}
+
+void TaskPool::wait(TaskGroup& group) {
+	size_t queue = home();
+	while (!group.done()) {
+		if (!runOne(queue))
+			std::this_thread::yield();
+	}
+}
+
+void TaskPool::work(size_t index) {
+	currentPool = this;
+	currentQueue = index;
+	while (true) {
+		if (runOne(index))
+			continue;
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		wake.wait(lock, [&]() { return stopping || queued.load(std::memory_order_relaxed) > 0; });
+		if (stopping && queued.load(std::memory_order_relaxed) == 0)
+			return;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// tasks started together, waited on together; the thread that waits runs queued tasks until the group is done
+class TaskGroup {
+public:
+	bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+private:
+	std::atomic<size_t> pending{ 0 };
+	friend class TaskPool;
+};
+
+// work-stealing thread pool: every worker has its own deque, runs its newest task first and, out of work,
+// takes the oldest task of another; threads outside the pool queue their tasks on one shared deque
+// a pool of no workers runs every task on the thread that starts it
+class TaskPool {
+public:
+	TaskPool() = default;
+	~TaskPool();
+
+	size_t size() const { return threads.size(); }
+
+	void resize(size_t workers);
+	void run(TaskGroup& group, std::function<void()> work);
+	void wait(TaskGroup& group);
+
+	// body(i) for every i in [begin, end), in chunks of grain indices, returning once all are done
+	template <class F>
+	void parallelFor(int begin, int end, int grain, const F& body) {
+		TaskGroup group;
+		for (int first = begin; first < end; first += grain) {
+			int last = std::min(end, first + grain);
+			run(group, [first, last, &body]() {
+				for (int i = first; i < last; i++)
+					body(i);
+			});
+		}
+		wait(group);
+	}
+private:
+	struct Task {
+		std::function<void()> work;
+		TaskGroup* group = nullptr;
+	};
+	struct Queue {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	std::vector<std::unique_ptr<Queue>> queues;	// one per worker, then the shared one
+	std::vector<std::thread> threads;
+	std::atomic<size_t> queued{ 0 };
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+	bool stopping = false;
+
+	size_t home() const;
+	bool runOne(size_t queue);
+	void work(size_t index);
+	void stop();
+};
+
+// worker count for a setting where 0 asks for one thread per hardware thread
+size_t threadCount(int setting);
+// hardware threads left over once taken of them are busy, for pools that would otherwise compete with those
+size_t spareThreads(size_t taken);
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include "testparticles.h"
+#include "forces.h"
+#include "profiler.h"
+
+template <class Real>
+void BasicTestParticles<Real>::add(const glm::dvec3& position, const glm::dvec3& velocity) {
+	px.push_back((Real)position.x);
+	py.push_back((Real)position.y);
+	pz.push_back((Real)position.z);
+	vx.push_back((Real)velocity.x);
+	vy.push_back((Real)velocity.y);
+	vz.push_back((Real)velocity.z);
+	for (std::vector<Real>* field : { &ax, &ay, &az })
+		field->push_back(0);
+	current = false;
+}
+
+template <class Real>
+void BasicTestParticles<Real>::clear() {
+	for (std::vector<Real>* field : { &px, &py, &pz, &vx, &vy, &vz, &ax, &ay, &az })
+		field->clear();
+	current = false;
+}
+
+// the next step starts from a fresh field pass, for when the bodies changed under the particles
+template <class Real>
+void BasicTestParticles<Real>::reset() {
+	current = false;
+}
+
+// accelerations of every particle in the field of the bodies, including the oblate terms
+template <class Real>
+void BasicTestParticles<Real>::accelerate(const BodyStore& s) {
+	size_t n = size();
+	pairInteractions += n * s.size();
+	std::vector<size_t> oblate = oblateGravity ? oblateBodies(s) : std::vector<size_t>();
+
+	int chunks = (int)((n + PARTICLE_CHUNK - 1) / PARTICLE_CHUNK);
+	#pragma omp parallel for schedule(dynamic)
+	for (int c = 0; c < chunks; c++) {
+		size_t begin = c * PARTICLE_CHUNK;
+		size_t end = std::min(n, begin + PARTICLE_CHUNK);
+		targetField(s, px.data(), py.data(), pz.data(), ax.data(), ay.data(), az.data(), begin, end);
+
+		for (size_t body : oblate) {
+			for (size_t i = begin; i < end; i++) {
+				glm::dvec3 target = position(i);
+				if (target == s.position(body))
+					continue;
+				glm::dvec3 acceleration = oblateAcceleration(s, body, target);
+				ax[i] += (Real)acceleration.x;
+				ay[i] += (Real)acceleration.y;
+				az[i] += (Real)acceleration.z;
+			}
+		}
+	}
+	current = true;
+}
+
+// first half kick and drift, in the field of the bodies before they step
+template <class Real>
+void BasicTestParticles<Real>::beginStep(const BodyStore& s, double dt) {
+	if (size() == 0)
+		return;
+	PhaseTimer timer(PHASE_PARTICLES);
+	if (!current)
+		accelerate(s);
+
+	Real halfStep = (Real)(0.5 * dt);
+	int n = (int)size();
+	#pragma omp parallel for schedule(static)
+	for (int i = 0; i < n; i++) {
+		vx[i] += ax[i] * halfStep;
+		vy[i] += ay[i] * halfStep;
+		vz[i] += az[i] * halfStep;
+		px[i] += vx[i] * (Real)dt;
+		py[i] += vy[i] * (Real)dt;
+		pz[i] += vz[i] * (Real)dt;
+	}
+	current = false;
+}
+
+// second half kick, in the field of the bodies after they stepped
+template <class Real>
+void BasicTestParticles<Real>::endStep(const BodyStore& s, double dt) {
+	if (size() == 0)
+		return;
+	PhaseTimer timer(PHASE_PARTICLES);
+	accelerate(s);
+
+	Real halfStep = (Real)(0.5 * dt);
+	int n = (int)size();
+	#pragma omp parallel for schedule(static)
+	for (int i = 0; i < n; i++) {
+		vx[i] += ax[i] * halfStep;
+		vy[i] += ay[i] * halfStep;
+		vz[i] += az[i] * halfStep;
+	}
+}
+
+template class BasicTestParticles<double>;
+template class BasicTestParticles<float>;
\ No newline at end of file
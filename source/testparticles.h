@@ -0,0 +1,40 @@
+#pragma once
+
+#include "bodystore.h"
+
+// particles handed to one task of the field pass, a multiple of every vector width
+const size_t PARTICLE_CHUNK = 1024;
+
+// massless bodies that feel the bodies of a store and pull on nothing: belt and ring particles, spacecraft
+// they are kept apart from the store so they never enter the pair loop, a field pass costs bodies x particles
+// and is vectorized over the particles, and the bodies step exactly as they would without them
+//
+// particles follow a kick-drift-kick leapfrog in the field of the bodies at the start and end of every step,
+// whichever integrator moves the bodies
+//
+// Real is double or float; in float a vector holds twice the particles, enough for belts and rings whose
+// members are only looked at together, while the bodies they orbit stay in double
+template <class Real>
+class BasicTestParticles {
+public:
+	std::vector<Real> px, py, pz;	// position
+	std::vector<Real> vx, vy, vz;	// velocity
+	std::vector<Real> ax, ay, az;	// acceleration in the field of the last pass
+
+	size_t size() const { return px.size(); }
+
+	void add(const glm::dvec3& position, const glm::dvec3& velocity);
+	void clear();
+	void reset();
+	void accelerate(const BodyStore& s);
+	void beginStep(const BodyStore& s, double dt);
+	void endStep(const BodyStore& s, double dt);
+
+	glm::dvec3 position(size_t i) const { return glm::dvec3(px[i], py[i], pz[i]); }
+	glm::dvec3 velocity(size_t i) const { return glm::dvec3(vx[i], vy[i], vz[i]); }
+private:
+	bool current = false;	// whether the accelerations belong to the positions
+};
+
+using TestParticles = BasicTestParticles<double>;
+using FloatParticles = BasicTestParticles<float>;
\ No newline at end of file
@@ -2,6 +2,8 @@
 #include <cstdlib>
 #include <cctype>
 
+bool headless = false;
+
 size_t getIntsFromString(const char* string, int* out, size_t n, char dem) {
 	size_t i = 0;
 
@@ -11,6 +11,9 @@ const float MIN_FRAME_TIME = 1.0f / 60.0f;
 
 // units : space in Mm, time in s
 const double G = 6.67430e-29; // Gravitational constant
+const double SPEED_OF_LIGHT = 299.792458;
+
+extern bool headless;	// no window or GL context, models and surfaces skip their uploads to the GPU
 
 enum render_mode : uint8_t {
 	MODE_TEX,
@@ -0,0 +1,212 @@
+#include "wisdomholman.h"
+#include "rotation.h"
+
+// hierarchy of relative coordinates from the parent of each body, built so that every cluster is complete
+// before it joins the one it orbits; bodies whose parent chain leads back to themselves are treated as roots
+void WisdomHolman::initialize(BodyStore& s) {
+	size_t n = s.size();
+	std::vector<std::vector<uint32_t>> children(n);
+	std::vector<uint32_t> roots;
+	for (size_t i = 0; i < n; i++) {
+		size_t ancestor = s.parent[i];
+		for (size_t depth = 0; ancestor < n && ancestor != i && depth < n; depth++)
+			ancestor = s.parent[ancestor];
+
+		if (s.parent[i] < n && ancestor != i)
+			children[s.parent[i]].push_back((uint32_t)i);
+		else
+			roots.push_back((uint32_t)i);
+	}
+
+	std::vector<double> clusterMass(s.mass.begin(), s.mass.end());
+	auto join = [&](uint32_t center, uint32_t orbiter) {
+		orbits.push_back({ center, orbiter, clusterMass[center], clusterMass[orbiter] });
+		clusterMass[center] += clusterMass[orbiter];
+	};
+
+	// depth-first, joining each child to its parent once the child's own satellites have joined it
+	orbits.clear();
+	std::vector<std::pair<uint32_t, size_t>> stack;
+	for (uint32_t top : roots) {
+		stack.emplace_back(top, 0);
+		while (!stack.empty()) {
+			uint32_t node = stack.back().first;
+			if (stack.back().second < children[node].size()) {
+				uint32_t child = children[node][stack.back().second++];
+				stack.emplace_back(child, 0);
+			}
+			else {
+				stack.pop_back();
+				if (!stack.empty())
+					join(stack.back().first, node);
+			}
+		}
+	}
+
+	root = roots.empty() ? 0 : roots[0];
+	for (size_t k = 1; k < roots.size(); k++)
+		join(root, roots[k]);
+
+	for (std::vector<glm::dvec3>* field : { &relativePosition, &relativeVelocity, &relativeAcceleration })
+		field->resize(orbits.size());
+	cluster.resize(n);
+
+	s.clearForces();
+	directForces(s);
+	for (size_t i = 0; i < n; i++)
+		s.torque[i] = glm::dvec3(s.tx[i], s.ty[i], s.tz[i]);
+	initialized = true;
+}
+
+// Cartesian vectors to relative ones and the barycentric total, replacing each orbiting cluster by its barycenter as it joins
+void WisdomHolman::toJacobi(const double* x, const double* y, const double* z,
+	std::vector<glm::dvec3>& relative, glm::dvec3& total) {
+	for (size_t i = 0; i < cluster.size(); i++)
+		cluster[i] = glm::dvec3(x[i], y[i], z[i]);
+
+	for (size_t k = 0; k < orbits.size(); k++) {
+		const JacobiOrbit& orbit = orbits[k];
+		relative[k] = cluster[orbit.orbiter] - cluster[orbit.center];
+		cluster[orbit.center] = (orbit.centerMass * cluster[orbit.center] + orbit.orbiterMass * cluster[orbit.orbiter])
+			/ (orbit.centerMass + orbit.orbiterMass);
+	}
+	total = cluster[root];
+}
+
+// the inverse, splitting the clusters apart in reverse order
+void WisdomHolman::fromJacobi(const std::vector<glm::dvec3>& relative, const glm::dvec3& total,
+	double* x, double* y, double* z) {
+	cluster[root] = total;
+	for (size_t k = orbits.size(); k-- > 0;) {
+		const JacobiOrbit& orbit = orbits[k];
+		double totalMass = orbit.centerMass + orbit.orbiterMass;
+		glm::dvec3 barycenter = cluster[orbit.center];
+		cluster[orbit.center] = barycenter - relative[k] * (orbit.orbiterMass / totalMass);
+		cluster[orbit.orbiter] = barycenter + relative[k] * (orbit.centerMass / totalMass);
+	}
+
+	for (size_t i = 0; i < cluster.size(); i++) {
+		x[i] = cluster[i].x;
+		y[i] = cluster[i].y;
+		z[i] = cluster[i].z;
+	}
+}
+
+// interaction kick: the relative acceleration of each coordinate less its Keplerian part
+void WisdomHolman::kick(const BodyStore& s, double dt) {
+	glm::dvec3 unused;
+	toJacobi(s.ax.data(), s.ay.data(), s.az.data(), relativeAcceleration, unused);
+
+	#pragma omp parallel for
+	for (int k = 0; k < (int)orbits.size(); k++) {
+		const JacobiOrbit& orbit = orbits[k];
+		double gm = G * (orbit.centerMass + orbit.orbiterMass);
+		double distance = glm::length(relativePosition[k]);
+		glm::dvec3 keplerian = -relativePosition[k] * (gm / (distance * distance * distance));
+		relativeVelocity[k] += (relativeAcceleration[k] - keplerian) * dt;
+	}
+}
+
+void WisdomHolman::step(BodyStore& s, double dt) {
+	if (!initialized || cluster.size() != s.size())
+		initialize(s);
+
+	int n = (int)s.size();
+	double halfDt = 0.5 * dt;
+
+	for (int i = 0; i < n; i++)
+		s.prevPosition[i] = s.position(i);
+
+	toJacobi(s.px.data(), s.py.data(), s.pz.data(), relativePosition, centerOfMass);
+	toJacobi(s.vx.data(), s.vy.data(), s.vz.data(), relativeVelocity, centerOfMassVelocity);
+	kick(s, halfDt);
+
+	#pragma omp parallel for
+	for (int k = 0; k < (int)orbits.size(); k++) {
+		const JacobiOrbit& orbit = orbits[k];
+		keplerDrift(G * (orbit.centerMass + orbit.orbiterMass), relativePosition[k], relativeVelocity[k], dt);
+	}
+	centerOfMass += centerOfMassVelocity * dt;
+	fromJacobi(relativePosition, centerOfMass, s.px.data(), s.py.data(), s.pz.data());
+
+	for (int i = 0; i < n; i++)
+		s.angularMomentum[i] += s.torque[i] * halfDt;
+	rotateBodies(s, dt);
+
+	// the Keplerian part is subtracted exactly, so the rest has to be summed directly as well
+	s.clearForces();
+	directForces(s);
+
+	kick(s, halfDt);
+	fromJacobi(relativeVelocity, centerOfMassVelocity, s.vx.data(), s.vy.data(), s.vz.data());
+
+	for (int i = 0; i < n; i++) {
+		s.torque[i] = glm::dvec3(s.tx[i], s.ty[i], s.tz[i]);
+		s.angularMomentum[i] += s.torque[i] * halfDt;
+	}
+}
+
+// Stumpff functions c0 to c3
+void stumpff(double z, double c[4]) {
+	if (fabs(z) < 1.0) {
+		// series, converged to round-off within ten terms
+		double term2 = 0.5, term3 = 1.0 / 6.0;
+		c[2] = c[3] = 0.0;
+		for (int k = 0; k < 10; k++) {
+			c[2] += term2;
+			c[3] += term3;
+			term2 *= -z / ((2 * k + 3) * (2 * k + 4));
+			term3 *= -z / ((2 * k + 4) * (2 * k + 5));
+		}
+		c[1] = 1.0 - z * c[3];
+		c[0] = 1.0 - z * c[2];
+	}
+	else {
+		double root = sqrt(fabs(z));
+		c[0] = z > 0.0 ? cos(root) : cosh(root);
+		c[1] = z > 0.0 ? sin(root) / root : sinh(root) / root;
+		c[2] = (1.0 - c[0]) / z;
+		c[3] = (1.0 - c[1]) / z;
+	}
+}
+
+// advances a two-body orbit of gravitational parameter gm by dt with universal variables,
+// so elliptic, parabolic and hyperbolic orbits share one solver
+void keplerDrift(double gm, glm::dvec3& position, glm::dvec3& velocity, double dt) {
+	double r0 = glm::length(position);
+	double eta = glm::dot(position, velocity);
+	double beta = 2.0 * gm / r0 - glm::dot(velocity, velocity);
+	double zeta = gm - beta * r0;
+
+	// universal anomaly x solving r0 G1 + eta G2 + gm G3 = dt, with Gn = x^n cn(beta x^2),
+	// by Laguerre-Conway iteration on a function whose derivative is the distance and so never vanishes
+	double x = dt / r0;
+	double c[4];
+	for (int iteration = 0; iteration < KEPLER_MAX_ITERATIONS; iteration++) {
+		stumpff(beta * x * x, c);
+		double g1 = x * c[1], g2 = x * x * c[2], g3 = x * x * x * c[3];
+		double f = r0 * g1 + eta * g2 + gm * g3 - dt;
+		double df = r0 * c[0] + eta * g1 + gm * g2;
+		double d2f = eta * c[0] + zeta * g1;
+
+		const double order = 5.0;
+		double root = sqrt(fabs((order - 1.0) * (order - 1.0) * df * df - order * (order - 1.0) * f * d2f));
+		double dx = order * f / (df + (df > 0.0 ? root : -root));
+		x -= dx;
+		if (fabs(dx) <= 1e-15 * fabs(x))
+			break;
+	}
+
+	// Gauss f and g functions
+	stumpff(beta * x * x, c);
+	double g1 = x * c[1], g2 = x * x * c[2], g3 = x * x * x * c[3];
+	double r = r0 * c[0] + eta * g1 + gm * g2;
+	double f = 1.0 - gm * g2 / r0;
+	double g = dt - gm * g3;
+	double df = -gm * g1 / (r * r0);
+	double dg = 1.0 - gm * g2 / r;
+
+	glm::dvec3 start = position;
+	position = f * start + g * velocity;
+	velocity = df * start + dg * velocity;
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "forces.h"
+
+// Laguerre iterations of the universal Kepler equation, which converge in a handful for any orbit
+const int KEPLER_MAX_ITERATIONS = 50;
+
+// two-body problem of one relative coordinate: the orbiting cluster against the cluster it orbits
+struct JacobiOrbit {
+	uint32_t center, orbiter;	// first bodies of the two clusters
+	double centerMass, orbiterMass;
+};
+
+// Wisdom-Holman mapping in hierarchical Jacobi coordinates
+// every body orbits the barycenter of its parent together with the parent's earlier children and their satellites,
+// and bodies without a parent orbit the barycenter of the earlier ones, so a moon's coordinate is relative to its planet
+// and the planet's is that of the planet-moon barycenter relative to the star
+// the Keplerian motion in each coordinate is solved exactly and only the remaining interactions are kicked,
+// which lets a step cover a few percent of the shortest orbit
+class WisdomHolman {
+public:
+	void step(BodyStore& s, double dt);
+	void reset() { initialized = false; }
+private:
+	bool initialized = false;
+	std::vector<JacobiOrbit> orbits;
+	uint32_t root = 0;
+	std::vector<glm::dvec3> relativePosition, relativeVelocity, relativeAcceleration, cluster;
+	glm::dvec3 centerOfMass, centerOfMassVelocity;
+
+	void initialize(BodyStore& s);
+	void toJacobi(const double* x, const double* y, const double* z, std::vector<glm::dvec3>& relative, glm::dvec3& total);
+	void fromJacobi(const std::vector<glm::dvec3>& relative, const glm::dvec3& total, double* x, double* y, double* z);
+	void kick(const BodyStore& s, double dt);
+};
+
+void stumpff(double z, double c[4]);
+void keplerDrift(double gm, glm::dvec3& position, glm::dvec3& velocity, double dt);
\ No newline at end of file